@@ -0,0 +1,267 @@
+#include <sstream>
+#include <fstream>
+#include "AsyncStorage.h"
+
+namespace Storage
+{
+    // ThreadPoolExecutor functions --------------------------------------------------------------------
+
+    ThreadPoolExecutor::ThreadPoolExecutor(size_t thread_count)
+    {
+        for (size_t i = 0; i < std::max<size_t>(thread_count, 1); ++i)
+            m_threads.emplace_back([this]() { run(); });
+    }
+
+    ThreadPoolExecutor::~ThreadPoolExecutor()
+    {
+        {
+            std::lock_guard<std::mutex> guard(m_lock);
+            m_stop = true;
+        }
+        m_ready.notify_all();
+
+        for (auto& t : m_threads)
+            t.join();
+    }
+
+    void ThreadPoolExecutor::post(std::function<void()> task)
+    {
+        {
+            std::lock_guard<std::mutex> guard(m_lock);
+            m_queue.push_back(std::move(task));
+        }
+        m_ready.notify_one();
+    }
+
+    void ThreadPoolExecutor::run()
+    {
+        for (;;)
+        {
+            std::function<void()> task;
+            {
+                std::unique_lock<std::mutex> lock(m_lock);
+                m_ready.wait(lock, [this]() { return m_stop || !m_queue.empty(); });
+                if (m_queue.empty())
+                    return;
+
+                task = std::move(m_queue.front());
+                m_queue.pop_front();
+            }
+            task();
+        }
+    }
+
+    // AsyncMutex functions ----------------------------------------------------------------------------
+
+    bool AsyncMutex::tryLock()
+    {
+        std::lock_guard<std::mutex> guard(m_lock);
+        if (m_locked)
+            return false;
+
+        m_locked = true;
+        return true;
+    }
+
+    bool AsyncMutex::lockOrEnqueue(std::coroutine_handle<> h, bool first)
+    {
+        std::lock_guard<std::mutex> guard(m_lock);
+        if (m_locked)
+        {
+            if (first)
+                m_waiters.push_front(h);
+            else
+                m_waiters.push_back(h);
+            return false;
+        }
+
+        m_locked = true;
+        return true;
+    }
+
+    void AsyncMutex::unlock()
+    {
+        // The lock is released at once, the woken waiter competes for it when the executor runs it
+        // and goes back to the head of the queue if somebody was faster
+        std::coroutine_handle<> next;
+        {
+            std::lock_guard<std::mutex> guard(m_lock);
+            m_locked = false;
+            if (m_waiters.empty())
+                return;
+
+            next = m_waiters.front();
+            m_waiters.pop_front();
+        }
+        m_executor.post([this, next]()
+        {
+            if (lockOrEnqueue(next, true))
+                next.resume();
+        });
+    }
+
+    // AsyncStorage functions --------------------------------------------------------------------------
+
+    AsyncStorage::AsyncStorage(PropertyStorage& storage, Executor& executor) : m_storage(storage), m_executor(executor), m_lock(executor)
+    {
+        m_storage.setChangeListener([this](const std::string& prop_name) { notifyWatchers(prop_name); });
+    }
+
+    AsyncStorage::~AsyncStorage()
+    {
+        m_storage.setChangeListener(nullptr);
+
+        // Pending watchers are resumed with an empty name, so their coroutines can finish
+        std::vector<WatchAwaiter*> pending;
+        {
+            std::lock_guard<std::mutex> guard(m_watchLock);
+            pending.swap(m_watchers);
+        }
+
+        for (auto w : pending)
+        {
+            w->m_changed.clear();
+            m_executor.post(w->m_handle);
+        }
+    }
+
+    void AsyncStorage::notifyWatchers(const std::string& prop_name)
+    {
+        std::vector<WatchAwaiter*> fired;
+        {
+            std::lock_guard<std::mutex> guard(m_watchLock);
+            auto it = std::partition(m_watchers.begin(), m_watchers.end(),
+                                     [&prop_name](const WatchAwaiter* w) { return prop_name.compare(0, w->m_prefix.size(), w->m_prefix) != 0; });
+            fired.assign(it, m_watchers.end());
+            m_watchers.erase(it, m_watchers.end());
+        }
+
+        for (auto w : fired)
+        {
+            w->m_changed = prop_name;
+            m_executor.post(w->m_handle);
+        }
+    }
+
+    bool AsyncStorage::LockedAwaiter::await_ready()
+    {
+        if (!m_owner.m_lock.tryLock())
+            return false;
+
+        run();
+        m_owner.m_lock.unlock();
+        m_done = true;
+        return true;
+    }
+
+    bool AsyncStorage::LockedAwaiter::await_suspend(std::coroutine_handle<> h)
+    {
+        // The lock could be released after await_ready, so continue at once if we got it now.
+        // The counter is updated before enqueueing since the coroutine may be resumed (and this awaiter gone) right after it.
+        ++m_owner.m_suspends;
+        if (m_owner.m_lock.lockOrEnqueue(h))
+        {
+            --m_owner.m_suspends;
+            return false;
+        }
+        return true;
+    }
+
+    void AsyncStorage::LockedAwaiter::complete()
+    {
+        // Called in await_resume: the lock is owned here unless the operation is already done
+        if (m_done)
+            return;
+
+        run();
+        m_owner.m_lock.unlock();
+        m_done = true;
+    }
+
+    Property* AsyncStorage::GetAwaiter::await_resume()
+    {
+        // Versioned reads do not need the lock
+        PropertyStorage& storage = m_owner.m_storage;
+        if (storage.isVersioningEnabled())
+            return storage.getPropertyAt(m_name, storage.currentVersion());
+
+        std::shared_lock<std::shared_mutex> lock(m_owner.m_dataLock);
+        return PropertyStorage::cloneProperty(storage.findProperty(m_name));
+    }
+
+    void AsyncStorage::SetAwaiter::run()
+    {
+        PropertyStorage& storage = m_owner.m_storage;
+        std::unique_lock<std::shared_mutex> lock(m_owner.m_dataLock);
+
+        if (!m_value)
+            m_result.ok = false;
+        else if (!storage.isProperyDefined(m_name))
+            m_result.ok = storage.defineProperty(m_name, m_value);
+        else
+            m_result.ok = storage.setProperty(m_name, m_value);
+
+        if (!m_result.ok)
+            m_result.error = m_value ? storage.getLastError() : "Wrong property value";
+    }
+
+    void AsyncStorage::PersistAwaiter::await_suspend(std::coroutine_handle<> h)
+    {
+        // File I/O is done in the executor, not in the thread of the caller.
+        // The lock is taken there, so it is not held while the task waits in the queue.
+        ++m_owner.m_suspends;
+        m_owner.m_executor.post([this, h]()
+        {
+            if (m_owner.m_lock.lockOrEnqueue(h))
+                h.resume();
+        });
+    }
+
+    void AsyncStorage::PersistAwaiter::run()
+    {
+        // File I/O and parsing are done without the data lock, it is held only to serialize or to apply the content
+        PropertyStorage& storage = m_owner.m_storage;
+
+        if (m_save)
+        {
+            std::ostringstream data;
+            {
+                std::shared_lock<std::shared_mutex> lock(m_owner.m_dataLock);
+                m_result.ok = storage.saveStorage(data);
+                if (!m_result.ok)
+                    m_result.error = storage.getLastError();
+            }
+
+            if (m_result.ok)
+            {
+                std::ofstream out(m_fileName, std::ios::binary | std::ios::trunc);
+                const std::string& bytes = data.str();
+                m_result.ok = out.is_open() && out.write(bytes.data(), bytes.size()) && out.flush();
+                if (!m_result.ok)
+                    m_result.error = out.is_open() ? "Write error" : "Cannot open file";
+            }
+        }
+        else
+        {
+            PropertyStorage loaded;
+            m_result.ok = loaded.loadStorage(m_fileName);
+            if (!m_result.ok)
+                m_result.error = loaded.getLastError();
+            else
+            {
+                std::unique_lock<std::shared_mutex> lock(m_owner.m_dataLock);
+                m_result.ok = storage.replaceContent(loaded);
+                if (!m_result.ok)
+                    m_result.error = storage.getLastError();
+            }
+        }
+    }
+
+    void AsyncStorage::WatchAwaiter::await_suspend(std::coroutine_handle<> h)
+    {
+        m_handle = h;
+
+        std::lock_guard<std::mutex> guard(m_owner.m_watchLock);
+        m_owner.m_watchers.push_back(this);
+    }
+}
@@ -0,0 +1,233 @@
+#pragma once
+
+#include <coroutine>
+#include <deque>
+#include <thread>
+#include <condition_variable>
+#include <functional>
+#include <shared_mutex>
+#include "PropertiesStorage.h"
+
+namespace Storage
+{
+    // Executor runs tasks and resumes suspended coroutines of AsyncStorage clients
+
+    class Executor
+    {
+    public:
+
+        virtual ~Executor() { }
+        virtual void post(std::function<void()> task) = 0;
+        void post(std::coroutine_handle<> h) { post(std::function<void()>([h]() { h.resume(); })); }
+
+        // "co_await executor.schedule()" continues the coroutine in the executor
+        auto schedule()
+        {
+            struct ScheduleAwaiter
+            {
+                Executor& executor;
+                bool await_ready() const { return false; }
+                void await_suspend(std::coroutine_handle<> h) { executor.post(h); }
+                void await_resume() const { }
+            };
+            return ScheduleAwaiter{ *this };
+        }
+    };
+
+    class ThreadPoolExecutor : public Executor
+    {
+    public:
+
+        explicit ThreadPoolExecutor(size_t thread_count);
+        ~ThreadPoolExecutor();
+
+        using Executor::post;
+        void post(std::function<void()> task) override;
+
+    private:
+
+        void run();
+
+        std::mutex m_lock;
+        std::condition_variable m_ready;
+        std::deque<std::function<void()>> m_queue;
+        bool m_stop = false;
+        std::vector<std::thread> m_threads;
+    };
+
+    // --------------------------------------------------------------------------------------------
+
+    // Mutex for coroutines: a waiting coroutine does not block a thread, it is suspended.
+    // unlock() releases the lock and wakes the first waiter in the executor, the waiter takes the lock itself
+    // when it runs (or goes back to the head of the queue), so the lock is never held by a queued coroutine.
+
+    class AsyncMutex
+    {
+    public:
+
+        AsyncMutex(Executor& executor) : m_executor(executor) { }
+
+        bool tryLock();
+        bool lockOrEnqueue(std::coroutine_handle<> h, bool first = false);    // false - "h" will be resumed owning the lock
+        void unlock();
+
+    private:
+
+        Executor& m_executor;
+        std::mutex m_lock;
+        bool m_locked = false;
+        std::deque<std::coroutine_handle<>> m_waiters;
+    };
+
+    struct AsyncResult
+    {
+        bool ok = true;
+        std::string error;
+
+        explicit operator bool() const { return ok; }
+    };
+
+    // --------------------------------------------------------------------------------------------
+
+    // Awaitable API of PropertyStorage:
+    //   Property* p = co_await async.get(name);          (copy of the value, caller deletes it; nullptr - not defined)
+    //   AsyncResult r = co_await async.set(name, value);  (defines the property if it is not defined yet)
+    //   std::string name = co_await async.watch(prefix);  (waits for the next change of a property with the prefix;
+    //                                                       empty name - AsyncStorage was destroyed, do not use it anymore)
+    //   AsyncResult r = co_await async.save(file_name) / async.load(file_name);
+    //
+    // get never suspends: it reads under a shared lock (a versioned storage is read without locks).
+    // Writes are serialized by an async mutex, set suspends only if another write holds it.
+    // save/load always continue in the executor since they do file I/O. The I/O and parsing run without the data lock,
+    // it is held only to serialize the storage (shared) or to apply the loaded content (exclusive).
+    // All writes to the storage have to go through AsyncStorage while it exists.
+
+    class AsyncStorage
+    {
+    public:
+
+        AsyncStorage(PropertyStorage& storage, Executor& executor);
+        ~AsyncStorage();
+
+        // Base of awaiters that run an operation under the write lock
+        class LockedAwaiter
+        {
+        public:
+
+            LockedAwaiter(AsyncStorage& owner) : m_owner(owner) { }
+            LockedAwaiter(const LockedAwaiter&) = delete;
+            virtual ~LockedAwaiter() { }
+
+            bool await_ready();
+            bool await_suspend(std::coroutine_handle<> h);
+
+        protected:
+
+            virtual void run() = 0;
+            void complete();
+
+            AsyncStorage& m_owner;
+            bool m_done = false;
+        };
+
+        class GetAwaiter
+        {
+        public:
+
+            GetAwaiter(AsyncStorage& owner, const std::string& prop_name) : m_owner(owner), m_name(prop_name) { }
+            GetAwaiter(const GetAwaiter&) = delete;
+
+            bool await_ready() const { return true; }
+            void await_suspend(std::coroutine_handle<>) const { }
+            Property* await_resume();
+
+        private:
+
+            AsyncStorage& m_owner;
+            std::string m_name;
+        };
+
+        class SetAwaiter : public LockedAwaiter
+        {
+        public:
+
+            SetAwaiter(AsyncStorage& owner, const std::string& prop_name, Property* value) : LockedAwaiter(owner), m_name(prop_name), m_value(value) { }
+            ~SetAwaiter() { delete m_value; }
+
+            AsyncResult await_resume() { complete(); return m_result; }
+
+        private:
+
+            void run() override;
+
+            std::string m_name;
+            Property* m_value;
+            AsyncResult m_result;
+        };
+
+        class PersistAwaiter : public LockedAwaiter
+        {
+        public:
+
+            PersistAwaiter(AsyncStorage& owner, const std::string& file_name, bool save) : LockedAwaiter(owner), m_fileName(file_name), m_save(save) { }
+
+            bool await_ready() { return false; }
+            void await_suspend(std::coroutine_handle<> h);
+            AsyncResult await_resume() { complete(); return m_result; }
+
+        private:
+
+            void run() override;
+
+            std::string m_fileName;
+            bool m_save;
+            AsyncResult m_result;
+        };
+
+        class WatchAwaiter
+        {
+        public:
+
+            WatchAwaiter(AsyncStorage& owner, const std::string& prefix) : m_owner(owner), m_prefix(prefix) { }
+            WatchAwaiter(const WatchAwaiter&) = delete;
+
+            bool await_ready() const { return false; }
+            void await_suspend(std::coroutine_handle<> h);
+            std::string await_resume() { return m_changed; }
+
+        private:
+
+            friend class AsyncStorage;
+
+            AsyncStorage& m_owner;
+            std::string m_prefix;
+            std::string m_changed;
+            std::coroutine_handle<> m_handle;
+        };
+
+        GetAwaiter get(const std::string& prop_name) { return GetAwaiter(*this, prop_name); }
+        SetAwaiter set(const std::string& prop_name, const String& val) { return SetAwaiter(*this, prop_name, new PropValue<String>(val)); }
+        SetAwaiter set(const std::string& prop_name, const Int32& val) { return SetAwaiter(*this, prop_name, new PropValue<Int32>(val)); }
+        SetAwaiter set(const std::string& prop_name, const Int64& val) { return SetAwaiter(*this, prop_name, new PropValue<Int64>(val)); }
+        SetAwaiter set(const std::string& prop_name, const Double& val) { return SetAwaiter(*this, prop_name, new PropValue<Double>(val)); }
+        SetAwaiter set(const std::string& prop_name, const Property* p) { return SetAwaiter(*this, prop_name, PropertyStorage::cloneProperty(p)); }
+        WatchAwaiter watch(const std::string& prefix) { return WatchAwaiter(*this, prefix); }
+        PersistAwaiter save(const std::string& file_name) { return PersistAwaiter(*this, file_name, true); }
+        PersistAwaiter load(const std::string& file_name) { return PersistAwaiter(*this, file_name, false); }
+
+        size_t suspendCount() const { return m_suspends.load(); }
+
+    private:
+
+        void notifyWatchers(const std::string& prop_name);
+
+        PropertyStorage& m_storage;
+        Executor& m_executor;
+        AsyncMutex m_lock;                  // serializes writes
+        std::shared_mutex m_dataLock;       // short in-memory access: shared for reads, exclusive for changes
+        std::atomic<size_t> m_suspends{ 0 };
+
+        std::mutex m_watchLock;
+        std::vector<WatchAwaiter*> m_watchers;
+    };
+}
@@ -18,6 +18,11 @@ inline bool isNumber(const std::string& s)
     return !s.empty() && std::find_if(s.begin(), s.end(), [](unsigned char c) { return !std::isdigit(c) && c != '+' && c != '-' && c != '.'; }) == s.end();
 }
 
+inline bool isUnsigned(const std::string& s)
+{
+    return !s.empty() && std::all_of(s.begin(), s.end(), [](unsigned char c) { return std::isdigit(c); });
+}
+
 inline void SplitText(const std::string& text, std::string& first, std::string& second, const std::string& delimiter)
 {
     std::string::size_type idx = text.find_first_of(delimiter);
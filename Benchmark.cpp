@@ -0,0 +1,340 @@
+#include <chrono>
+#include <thread>
+#include <random>
+#include <iomanip>
+#include <sstream>
+#include "Benchmark.h"
+#include "PropertiesStorage.h"
+#include "AsyncStorage.h"
+
+namespace Bench
+{
+    using Clock = std::chrono::steady_clock;
+
+    static std::string propName(size_t i)
+    {
+        return "prop_" + std::to_string(i);
+    }
+
+    // Versioning (MVCC) ------------------------------------------------------------------------------------
+
+    // Reader throughput of consistent multi-key reads (readAt) without and with a concurrent writer
+
+    static double measureReaders(Storage::PropertyStorage& st, size_t prop_count, size_t readers, bool with_writer)
+    {
+        const size_t keysPerRead = 16;
+        const std::chrono::milliseconds duration(1000);
+
+        std::atomic<bool> stop{ false };
+        std::atomic<size_t> totalReads{ 0 };
+        std::vector<std::thread> threads;
+
+        for (size_t r = 0; r < readers; ++r)
+        {
+            threads.emplace_back([&, r]()
+            {
+                std::mt19937 rnd((unsigned)r + 1);
+                std::vector<std::string> names(keysPerRead);
+                std::vector<Storage::Property*> values;
+                size_t reads = 0;
+
+                while (!stop.load(std::memory_order_relaxed))
+                {
+                    for (auto& name : names)
+                        name = propName(rnd() % prop_count);
+
+                    st.readAt(st.currentVersion(), names, values);
+                    for (auto p : values)
+                        delete p;
+                    ++reads;
+                }
+                totalReads += reads;
+            });
+        }
+
+        std::thread writer;
+        if (with_writer)
+        {
+            writer = std::thread([&]()
+            {
+                std::mt19937 rnd(12345);
+                while (!stop.load(std::memory_order_relaxed))
+                    st.setProp(propName(rnd() % prop_count), (Storage::Int32)rnd());
+            });
+        }
+
+        std::this_thread::sleep_for(duration);
+        stop = true;
+
+        for (auto& t : threads)
+            t.join();
+        if (writer.joinable())
+            writer.join();
+
+        return totalReads.load() / std::chrono::duration<double>(duration).count();
+    }
+
+    void RunVersioning(std::ostream& out)
+    {
+        const size_t propCount = 10000;
+
+        Storage::PropertyStorage st("bench");
+        for (size_t i = 0; i < propCount; ++i)
+            st.defineProperty(propName(i), Storage::PropertyType::Type_Int32);
+        st.enableVersioning(4);
+
+        out << "Versioning: readAt() of 16 keys, " << propCount << " properties, retention depth 4" << std::endl;
+        out << std::setw(10) << "readers" << std::setw(18) << "reads/s" << std::setw(18) << "reads/s +writer" << std::setw(10) << "ratio" << std::endl;
+
+        // hardware_concurrency() may return 0, so clamp it before leaving one core for the writer
+        size_t maxReaders = std::max(2u, std::thread::hardware_concurrency()) - 1;
+        for (size_t readers = 1; readers <= maxReaders; readers *= 2)
+        {
+            double alone = measureReaders(st, propCount, readers, false);
+            double shared = measureReaders(st, propCount, readers, true);
+
+            out << std::setw(10) << readers << std::setw(18) << std::fixed << std::setprecision(0) << alone
+                << std::setw(18) << shared << std::setw(10) << std::setprecision(2) << shared / alone << std::endl;
+        }
+        out << "Versions published: " << st.currentVersion() << std::endl << std::endl;
+    }
+
+    // Snapshot compression -----------------------------------------------------------------------------
+
+    // Storage with long shared name prefixes and mostly small numbers, like our configuration dumps
+
+    static void fillRepetitiveStorage(Storage::PropertyStorage& st, size_t prop_count)
+    {
+        static const char* states[] = { "active", "standby", "draining", "offline" };
+        std::mt19937 rnd(42);
+
+        for (size_t i = 0; i < prop_count; ++i)
+        {
+            std::ostringstream name;
+            name << "cluster_" << std::setw(2) << std::setfill('0') << i / 50000
+                 << ".node_" << std::setw(4) << i / 50 % 1000 << ".metrics.counter_" << std::setw(2) << i % 50;
+
+            switch (i % 5)
+            {
+            case 0:
+            case 1:
+                st.defineProperty(name.str(), Storage::PropertyType::Type_Int32);
+                st.setProp(name.str(), (Storage::Int32)(rnd() % 100));
+                break;
+            case 2:
+                st.defineProperty(name.str(), Storage::PropertyType::Type_Int64);
+                st.setProp(name.str(), (Storage::Int64)1600000000000 + (Storage::Int64)i * 10);
+                break;
+            case 3:
+                st.defineProperty(name.str(), Storage::PropertyType::Type_String);
+                st.setProp(name.str(), Storage::String(states[rnd() % 4]));
+                break;
+            default:
+                st.defineProperty(name.str(), Storage::PropertyType::Type_Double);
+                st.setProp(name.str(), (Storage::Double)(rnd() % 1000) / 4);
+                break;
+            }
+        }
+    }
+
+    void RunCompression(std::ostream& out)
+    {
+        const size_t propCount = 200000;
+        const int rounds = 5;
+
+        Storage::PropertyStorage st("bench");
+        fillRepetitiveStorage(st, propCount);
+
+        std::ostringstream dump;
+        dump << st;
+        double dumpMB = dump.str().size() / (1024.0 * 1024.0);
+
+        out << "Compression: " << propCount << " properties, \"GET *\" text is " << dump.str().size() << " bytes" << std::endl;
+        out << "MB/s are measured for the size of \"GET *\" text" << std::endl;
+        out << std::setw(16) << "format" << std::setw(12) << "bytes" << std::setw(10) << "ratio"
+            << std::setw(14) << "encode MB/s" << std::setw(14) << "decode MB/s" << std::endl;
+
+        for (bool compress : { false, true })
+        {
+            std::string data;
+            auto start = Clock::now();
+            for (int i = 0; i < rounds; ++i)
+            {
+                std::ostringstream os;
+                st.saveStorage(os, compress);
+                data = os.str();
+            }
+            double encodeSec = std::chrono::duration<double>(Clock::now() - start).count() / rounds;
+
+            bool loaded = true;
+            start = Clock::now();
+            for (int i = 0; i < rounds; ++i)
+            {
+                Storage::PropertyStorage copy;
+                std::istringstream is(data);
+                loaded = copy.loadStorage(is) && copy.propCount() == propCount && loaded;
+            }
+            double decodeSec = std::chrono::duration<double>(Clock::now() - start).count() / rounds;
+
+            out << std::setw(16) << (compress ? "prefix+varint+LZ" : "prefix+varint") << std::setw(12) << data.size()
+                << std::setw(10) << std::fixed << std::setprecision(2) << (double)dump.str().size() / data.size()
+                << std::setw(14) << std::setprecision(1) << dumpMB / encodeSec << std::setw(14) << dumpMB / decodeSec
+                << (loaded ? "" : "  LOAD FAILED") << std::endl;
+        }
+        out << std::endl;
+    }
+
+    // Async (coroutines) -----------------------------------------------------------------------------------
+
+    struct DetachedTask
+    {
+        struct promise_type
+        {
+            DetachedTask get_return_object() { return {}; }
+            std::suspend_never initial_suspend() noexcept { return {}; }
+            std::suspend_never final_suspend() noexcept { return {}; }
+            void return_void() { }
+            void unhandled_exception() { std::terminate(); }
+        };
+    };
+
+    struct Completion
+    {
+        std::mutex lock;
+        std::condition_variable done;
+        size_t running = 0;
+    };
+
+    // Client does 9 reads per 1 write of random properties
+    static DetachedTask asyncClient(Storage::Executor& ex, Storage::AsyncStorage& st, unsigned id, size_t prop_count, size_t ops, Completion& completion)
+    {
+        co_await ex.schedule();
+
+        std::mt19937 rnd(id);
+        for (size_t i = 0; i < ops; ++i)
+        {
+            std::string name = propName(rnd() % prop_count);
+            if (i % 10 == 9)
+                co_await st.set(name, (Storage::Int32)i);
+            else
+                delete co_await st.get(name);
+        }
+
+        std::lock_guard<std::mutex> guard(completion.lock);
+        if (--completion.running == 0)
+            completion.done.notify_one();
+    }
+
+    void RunAsync(std::ostream& out)
+    {
+        const size_t propCount = 10000;
+        const size_t opsPerClient = 100;
+        size_t threads = std::max(1u, std::thread::hardware_concurrency());
+
+        out << "Async: coroutine clients, 90% get / 10% set, " << propCount << " properties, " << threads << " executor threads" << std::endl;
+        out << std::setw(10) << "clients" << std::setw(12) << "versioned" << std::setw(14) << "ops/s" << std::setw(14) << "suspended %" << std::endl;
+
+        for (bool versioned : { false, true })
+        {
+            for (size_t clients : { 100, 1000, 10000 })
+            {
+                Storage::PropertyStorage st("bench");
+                for (size_t i = 0; i < propCount; ++i)
+                    st.defineProperty(propName(i), Storage::PropertyType::Type_Int32);
+                if (versioned)
+                    st.enableVersioning(4);
+
+                Storage::ThreadPoolExecutor ex(threads);
+                Storage::AsyncStorage async(st, ex);
+                Completion completion;
+                completion.running = clients;
+
+                auto start = Clock::now();
+                for (size_t c = 0; c < clients; ++c)
+                    asyncClient(ex, async, (unsigned)c + 1, propCount, opsPerClient, completion);
+                {
+                    std::unique_lock<std::mutex> lock(completion.lock);
+                    completion.done.wait(lock, [&]() { return completion.running == 0; });
+                }
+                double sec = std::chrono::duration<double>(Clock::now() - start).count();
+
+                size_t ops = clients * opsPerClient;
+                out << std::setw(10) << clients << std::setw(12) << (versioned ? "yes" : "no")
+                    << std::setw(14) << std::fixed << std::setprecision(0) << ops / sec
+                    << std::setw(14) << std::setprecision(2) << 100.0 * async.suspendCount() / ops << std::endl;
+            }
+        }
+        out << std::endl;
+    }
+
+    // Batch lookup -------------------------------------------------------------------------------------------
+
+    // Random batches of 32 names: loop of getProperty() calls (std::map), loop of findProperty() calls
+    // (the same hash index as getMany, one key at a time, no prefetch) and one getMany() call.
+    // "prefetch gain" is the effect of batching alone, "vs map" includes the change of the data structure.
+
+    void RunBatchLookup(std::ostream& out)
+    {
+        const size_t batchSize = 32;
+        const size_t batches = 50000;
+
+        out << "Batch lookup: " << batches << " random batches of " << batchSize << " names" << std::endl;
+        out << std::setw(12) << "properties" << std::setw(16) << "getProperty/s" << std::setw(16) << "findProperty/s" << std::setw(16) << "getMany/s"
+            << std::setw(16) << "prefetch gain" << std::setw(10) << "vs map" << std::endl;
+
+        for (size_t propCount : { 10000, 2000000 })
+        {
+            Storage::PropertyStorage st("bench");
+            std::vector<std::string> names(propCount);
+            for (size_t i = 0; i < propCount; ++i)
+            {
+                names[i] = propName(i);
+                st.defineProperty(names[i], Storage::PropertyType::Type_Int32);
+            }
+
+            std::mt19937 rnd(7);
+            std::vector<size_t> queries(batches * batchSize);
+            for (auto& q : queries)
+                q = rnd() % propCount;
+
+            size_t found = 0;
+            auto start = Clock::now();
+            for (size_t i = 0; i < queries.size(); ++i)
+                found += st.getProperty(names[queries[i]]) != nullptr;
+            double singleSec = std::chrono::duration<double>(Clock::now() - start).count();
+
+            start = Clock::now();
+            for (size_t i = 0; i < queries.size(); ++i)
+                found += st.findProperty(names[queries[i]]) != nullptr;
+            double indexSec = std::chrono::duration<double>(Clock::now() - start).count();
+
+            std::vector<std::string_view> keys(batchSize);
+            start = Clock::now();
+            for (size_t b = 0; b < batches; ++b)
+            {
+                for (size_t i = 0; i < batchSize; ++i)
+                    keys[i] = names[queries[b * batchSize + i]];
+
+                for (auto p : st.getMany(keys))
+                    found += p != nullptr;
+            }
+            double batchSec = std::chrono::duration<double>(Clock::now() - start).count();
+
+            out << std::setw(12) << propCount << std::setw(16) << std::fixed << std::setprecision(0) << queries.size() / singleSec
+                << std::setw(16) << queries.size() / indexSec << std::setw(16) << queries.size() / batchSec
+                << std::setw(16) << std::setprecision(2) << indexSec / batchSec << std::setw(10) << singleSec / batchSec
+                << (found == 3 * queries.size() ? "" : "  LOOKUP FAILED") << std::endl;
+        }
+        out << std::endl;
+    }
+
+    // ------------------------------------------------------------------------------------------------------
+
+    void RunAll(std::ostream& out)
+    {
+        RunVersioning(out);
+        RunCompression(out);
+        RunAsync(out);
+        RunBatchLookup(out);
+    }
+}
@@ -0,0 +1,14 @@
+#pragma once
+#include <iostream>
+
+namespace Bench
+{
+    // Benchmarks are started from the command line: "PropStorage.exe --bench"
+
+    void RunVersioning(std::ostream& out);
+    void RunCompression(std::ostream& out);
+    void RunAsync(std::ostream& out);
+    void RunBatchLookup(std::ostream& out);
+
+    void RunAll(std::ostream& out);
+}
@@ -6,18 +6,27 @@ void Console::Run(std::istream& in, std::ostream& out)
     if (!storage.getName().empty())
         out << "Console for storage: [" << storage.getName() << "]" << std::endl << std::endl;
 
-    std::string input, cmn_name, cmn_text;
+    std::string input;
+    bool running = true;
     do
     {
         out << ">";
         std::getline(in, input);
-        ltrim(input);
-
-        SplitText(input, cmn_name, cmn_text, " ");
-        ProcessCommand(out, cmn_name, cmn_text);
+        running = ProcessLine(out, input);
         out << std::endl;
     } 
-    while (cmn_name != "EXIT");
+    while (running);
+}
+
+bool Console::ProcessLine(std::ostream& out, std::string input)
+{
+    std::string cmn_name, cmn_text;
+
+    ltrim(input);
+    SplitText(input, cmn_name, cmn_text, " ");
+    ProcessCommand(out, cmn_name, cmn_text);
+
+    return cmn_name != "EXIT";
 }
 
 void Console::ProcessCommand(std::ostream& out, std::string cmn_name, std::string cmn_text)
@@ -25,6 +34,7 @@ void Console::ProcessCommand(std::ostream& out, std::string cmn_name, std::strin
     if (cmn_name == "GET")
     {
         cmn_text = trim(cmn_text);
+
         if (cmn_text.empty())
             out << "Wrong syntax." << std::endl;
         else if (cmn_text == "*")
@@ -42,6 +52,44 @@ void Console::ProcessCommand(std::ostream& out, std::string cmn_name, std::strin
                 out << "Property not defined." << std::endl;
         }
     }
+    else if (cmn_name == "GETAT")
+    {
+        // Name is separated from the version by the last '@', so names with '@' are readable too
+        cmn_text = trim(cmn_text);
+        std::string::size_type at = cmn_text.rfind('@');
+
+        if (at == std::string::npos || !isUnsigned(cmn_text.substr(at + 1)))
+            out << "Wrong syntax." << std::endl;
+        else if (!storage.isVersioningEnabled())
+            out << "Versioning is disabled." << std::endl;
+        else
+            ProcessGetAt(out, trim(cmn_text.substr(0, at)), cmn_text.substr(at + 1));
+    }
+    else if (cmn_name == "MGET")
+    {
+        // "MGET name1 name2 ..." (names are separated by spaces)
+        std::istringstream iss(cmn_text);
+        std::vector<std::string> names;
+        std::string name;
+        while (iss >> name)
+            names.push_back(name);
+
+        if (names.empty())
+            out << "Wrong syntax." << std::endl;
+        else
+        {
+            std::vector<std::string_view> keys(names.begin(), names.end());
+            std::vector<const Storage::Property*> values = storage.getMany(keys);
+
+            for (size_t i = 0; i < names.size(); ++i)
+            {
+                if (values[i])
+                    out << names[i] << " = " << values[i] << std::endl;
+                else
+                    out << names[i] << ": Property not defined." << std::endl;
+            }
+        }
+    }
     else if (cmn_name == "SET")
     {
         std::string prop_name, prop_value;
@@ -78,7 +126,7 @@ void Console::ProcessCommand(std::ostream& out, std::string cmn_name, std::strin
                 {
                     if (prop->fromString(prop_value))
                     {
-                        if (!storage.defineProperty(prop_name, prop->getType()) || !storage.setProperty(prop_name, prop))
+                        if (!storage.defineProperty(prop_name, prop))
                             out << storage.getLastError() << std::endl;
                         else
                             out << "New property was added to the storage." << std::endl;
@@ -104,9 +152,76 @@ void Console::ProcessCommand(std::ostream& out, std::string cmn_name, std::strin
                 out << storage.getLastError() << std::endl;
         }
     }
+    else if (cmn_name == "SAVE" || cmn_name == "LOAD")
+    {
+        cmn_text = trim(cmn_text);
+        if (cmn_text.empty())
+            out << "Wrong syntax." << std::endl;
+        else if (cmn_name == "SAVE")
+        {
+            if (storage.saveStorage(cmn_text))
+                out << "Storage was saved." << std::endl;
+            else
+                out << storage.getLastError() << std::endl;
+        }
+        else
+        {
+            if (storage.loadStorage(cmn_text))
+                out << "Storage was loaded." << std::endl;
+            else
+                out << storage.getLastError() << std::endl;
+        }
+    }
+    else if (cmn_name == "VERSION")
+    {
+        if (storage.isVersioningEnabled())
+            out << storage.currentVersion() << std::endl;
+        else
+            out << "Versioning is disabled." << std::endl;
+    }
     else
     {
         if (cmn_name != "EXIT") 
             out << "Unknown command." << std::endl;
     }
 }
+
+void Console::ProcessGetAt(std::ostream& out, const std::string& prop_name, const std::string& version_text)
+{
+    // "GETAT name@version" and "GETAT *@version"
+
+    Storage::Version version = 0;
+    try
+    {
+        version = std::stoull(version_text);
+    }
+    catch (...) { }
+
+    if (prop_name.empty() || version == 0)
+        out << "Wrong syntax." << std::endl;
+    else if (version > storage.currentVersion())
+        out << "Version is not reached yet." << std::endl;
+    else if (prop_name == "*")
+    {
+        Storage::PropertyStorage snapshot;
+        if (!storage.snapshotAt(version, snapshot))
+            out << "Version is not retained." << std::endl;
+        else if (snapshot.propCount() > 0)
+            out << snapshot;
+        else
+            out << "No properties defined at this version." << std::endl;
+    }
+    else
+    {
+        Storage::VersionStatus status;
+        Storage::Property* prop = storage.getPropertyAt(prop_name, version, &status);
+        if (prop)
+            out << prop << std::endl;
+        else if (status == Storage::VersionStatus::Status_NotRetained)
+            out << "Version is not retained." << std::endl;
+        else
+            out << "Property not defined at this version." << std::endl;
+
+        delete prop;
+    }
+}
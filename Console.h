@@ -8,10 +8,12 @@ public:
     Console(Storage::PropertyStorage& s) : storage(s) { }
 
     void Run(std::istream& in, std::ostream& out);
+    bool ProcessLine(std::ostream& out, std::string input);    // false - "EXIT" command
 
 private:
 
     void ProcessCommand(std::ostream& out, std::string cmn_name, std::string cmn_text);
+    void ProcessGetAt(std::ostream& out, const std::string& prop_name, const std::string& version_text);
 
     Storage::PropertyStorage &storage;
 };
@@ -0,0 +1,555 @@
+#include <sstream>
+#include <random>
+#include <chrono>
+#include <vector>
+#include <map>
+#include <variant>
+#include <memory>
+#include <algorithm>
+#include <cctype>
+#include <iomanip>
+#include <cstdlib>
+#include "Fuzz.h"
+
+namespace Fuzz
+{
+    namespace
+    {
+        const char* PropertyNames[] = { "str", "number", "very_long", "dbl", "a", "ab", "a.b", "a.b.c", "x y", "k=v", "n@x", "n@1", "*", "" };
+
+        // Frozen copy of the parsing code (Auxiliary.h, PropValue<T>::fromString, createProperty by value).
+        // Do not change it together with the console: differences have to show up as mismatches.
+
+        namespace Frozen
+        {
+            void ltrim(std::string& s)
+            {
+                s.erase(s.begin(), std::find_if(s.begin(), s.end(), [](unsigned char c) { return !std::isspace(c); }));
+            }
+
+            std::string trim(std::string s)
+            {
+                s.erase(s.begin(), std::find_if(s.begin(), s.end(), [](unsigned char c) { return !std::isspace(c); }));
+                s.erase(std::find_if(s.rbegin(), s.rend(), [](unsigned char c) { return !std::isspace(c); }).base(), s.end());
+                return s;
+            }
+
+            bool isNumber(const std::string& s)
+            {
+                return !s.empty() && std::find_if(s.begin(), s.end(), [](unsigned char c) { return !std::isdigit(c) && c != '+' && c != '-' && c != '.'; }) == s.end();
+            }
+
+            void SplitText(const std::string& text, std::string& first, std::string& second, const std::string& delimiter)
+            {
+                std::string::size_type idx = text.find_first_of(delimiter);
+                if (idx == std::string::npos)
+                {
+                    first = trim(text);
+                    second.clear();
+                }
+                else
+                {
+                    first = trim(text.substr(0, idx));
+                    second = text.substr(idx + delimiter.length());
+                }
+            }
+
+            // Command name as Console::ProcessLine sees it
+            std::string commandName(std::string input)
+            {
+                std::string cmn_name, cmn_text;
+                ltrim(input);
+                SplitText(input, cmn_name, cmn_text, " ");
+                return cmn_name;
+            }
+
+            using Value = std::variant<Storage::String, Storage::Int32, Storage::Int64, Storage::Double>;
+
+            std::string toString(const Value& v)
+            {
+                std::ostringstream oss;
+                if (v.index() == 0)
+                    oss << "\"" << std::get<Storage::String>(v) << "\"";
+                else if (v.index() == 1)
+                    oss << std::get<Storage::Int32>(v);
+                else if (v.index() == 2)
+                    oss << std::get<Storage::Int64>(v);
+                else
+                    oss << std::setprecision(5) << std::setiosflags(std::ios::fixed) << std::get<Storage::Double>(v);
+                return oss.str();
+            }
+
+            // Parses the value keeping the type of "v"
+            bool fromString(const std::string& value, Value& v, std::string& error)
+            {
+                try
+                {
+                    if (v.index() == 0)
+                        v = value;
+                    else if (v.index() == 1)
+                    {
+                        Storage::Int32 n = std::stol(value);
+                        v = n;
+                    }
+                    else if (v.index() == 2)
+                    {
+                        Storage::Int64 n = std::stoll(value);
+                        v = n;
+                    }
+                    else
+                    {
+                        Storage::Double d = std::stold(value);
+                        v = d;
+                    }
+                    return true;
+                }
+                catch (const std::invalid_argument&)
+                {
+                    error = "Invalid property value";
+                }
+                catch (const std::out_of_range&)
+                {
+                    error = "Out of Range error";
+                }
+                return false;
+            }
+
+            // Type of a new property by its value
+            bool typeOf(const std::string& value, Value& v)
+            {
+                try
+                {
+                    if (isNumber(value))
+                    {
+                        if (value.find_first_of(".") != std::string::npos)
+                            v = Storage::Double(0.0);
+                        else
+                        {
+                            try
+                            {
+                                std::stol(value);
+                                v = Storage::Int32(0);
+                            }
+                            catch (const std::out_of_range&)
+                            {
+                                v = Storage::Int64(0);
+                            }
+                        }
+                    }
+                    else
+                        v = Storage::String();
+                    return true;
+                }
+                catch (...) {}
+
+                return false;
+            }
+        }
+
+        // Reference engine: frozen console semantics over a std::map
+
+        class ReferenceEngine : public Engine
+        {
+        public:
+
+            ReferenceEngine() : Engine("reference")
+            {
+                m_props["str"] = Storage::String();
+                m_props["number"] = Storage::Int32(0);
+                m_props["very_long"] = Storage::Int64(0);
+                m_props["dbl"] = Storage::Double(0.0);
+            }
+
+            std::string execute(const std::string& line) override;
+
+        private:
+
+            std::map<std::string, Frozen::Value> m_props;
+        };
+
+        std::string ReferenceEngine::execute(const std::string& line)
+        {
+            std::ostringstream out;
+            std::string input = line, cmn_name, cmn_text;
+
+            Frozen::ltrim(input);
+            Frozen::SplitText(input, cmn_name, cmn_text, " ");
+
+            if (cmn_name == "GET")
+            {
+                cmn_text = Frozen::trim(cmn_text);
+                if (cmn_text.empty())
+                    out << "Wrong syntax." << std::endl;
+                else if (cmn_text == "*")
+                {
+                    if (m_props.empty())
+                        out << "No properties defined in the storage." << std::endl;
+                    for (const auto& it : m_props)
+                        out << it.first << " = " << Frozen::toString(it.second) << std::endl;
+                }
+                else
+                {
+                    auto it = m_props.find(cmn_text);
+                    if (it != m_props.end())
+                        out << Frozen::toString(it->second) << std::endl;
+                    else
+                        out << "Property not defined." << std::endl;
+                }
+            }
+            else if (cmn_name == "MGET")
+            {
+                std::istringstream iss(cmn_text);
+                std::vector<std::string> names;
+                std::string name;
+                while (iss >> name)
+                    names.push_back(name);
+
+                if (names.empty())
+                    out << "Wrong syntax." << std::endl;
+                for (const auto& n : names)
+                {
+                    auto it = m_props.find(n);
+                    if (it != m_props.end())
+                        out << n << " = " << Frozen::toString(it->second) << std::endl;
+                    else
+                        out << n << ": Property not defined." << std::endl;
+                }
+            }
+            else if (cmn_name == "SET")
+            {
+                std::string prop_name, prop_value, error;
+                Frozen::SplitText(cmn_text, prop_name, prop_value, "=");
+
+                if (prop_name.empty() || prop_value.empty())
+                    out << "Wrong syntax." << std::endl;
+                else
+                {
+                    auto it = m_props.find(prop_name);
+                    Frozen::Value v;
+                    if (it != m_props.end())
+                    {
+                        v = it->second;
+                        if (Frozen::fromString(prop_value, v, error))
+                            it->second = v;
+                        else
+                            out << error << std::endl;
+                    }
+                    else if (!Frozen::typeOf(prop_value, v))
+                        out << "Cannot determine type for a new (not defined) property." << std::endl;
+                    else if (!Frozen::fromString(prop_value, v, error))
+                        out << error << std::endl;
+                    else
+                    {
+                        m_props[prop_name] = v;
+                        out << "New property was added to the storage." << std::endl;
+                    }
+                }
+            }
+            else if (cmn_name == "DELETE")
+            {
+                cmn_text = Frozen::trim(cmn_text);
+                if (cmn_text.empty())
+                    out << "Wrong syntax." << std::endl;
+                else if (m_props.erase(cmn_text))
+                    out << "Property was deleted." << std::endl;
+                else
+                    out << "Property not defined" << std::endl;
+            }
+            else if (cmn_name != "EXIT")
+                out << "Unknown command." << std::endl;
+
+            return out.str();
+        }
+
+        // false for commands which are not modeled by the reference engine
+        bool isCompared(const std::string& line)
+        {
+            std::string cmn_name = Frozen::commandName(line);
+            return cmn_name != "GETAT" && cmn_name != "VERSION" && cmn_name != "SAVE" && cmn_name != "LOAD";
+        }
+
+        // ------------------------------------------------------------------------------------------------
+
+        // Random commands over a small vocabulary of names and values with parser edge cases.
+        // "SAVE" and "LOAD" are not generated since they touch files.
+
+        class CommandGenerator
+        {
+        public:
+
+            CommandGenerator(unsigned seed) : m_rnd(seed) { }
+
+            std::string next()
+            {
+                static const char* values[] = { "0", "-1", "+5", "007", "2147483647", "2147483648", "-2147483649", "9223372036854775807",
+                                                "9223372036854775808", "3.14", "-.5", ".", "+-.", "--1", "1e5", "0x10", "12abc",
+                                                "abc", "hello world", "=", "  ", "\"q\"", "1.2.3", "" };
+
+                std::string cmd;
+                unsigned kind = m_rnd() % 100;
+                if (kind < 40)
+                    cmd = "SET " + pick(PropertyNames) + "=" + pick(values);
+                else if (kind < 68)
+                    cmd = "GET " + pick(PropertyNames);
+                else if (kind < 73)
+                    cmd = "GET *";
+                else if (kind < 83)
+                    cmd = "DELETE " + pick(PropertyNames);
+                else if (kind < 88)
+                {
+                    cmd = "MGET";
+                    for (unsigned i = 1 + m_rnd() % 4; i > 0; --i)
+                        cmd += " " + pick(PropertyNames);
+                }
+                else if (kind < 90)
+                    cmd = "GETAT " + pick(PropertyNames) + "@" + std::to_string(m_rnd() % 64);
+                else if (kind < 97)
+                    cmd = garbage();
+                else
+                {
+                    static const char* others[] = { "EXIT", "get number", "SET", "GET", "DELETE", "SETnumber=1", "SET =1", "SET number==1", "VERSION", "GETAT" };
+                    cmd = pick(others);
+                }
+
+                // Random spaces around the command and its parts
+                if (m_rnd() % 8 == 0)
+                    cmd = "  " + cmd;
+                if (m_rnd() % 8 == 0)
+                    cmd += " \t";
+                if (m_rnd() % 16 == 0)
+                {
+                    std::string::size_type idx = cmd.find('=');
+                    if (idx != std::string::npos)
+                        cmd.insert(idx, " ");
+                }
+                return cmd;
+            }
+
+        private:
+
+            template<size_t N> std::string pick(const char* (&items)[N]) { return items[m_rnd() % N]; }
+
+            std::string garbage()
+            {
+                static const char chars[] = " =*.+-@0123456789abcxyzGETDT\t";
+                std::string s(m_rnd() % 24, ' ');
+                for (auto& c : s)
+                    c = chars[m_rnd() % (sizeof(chars) - 1)];
+                return s;
+            }
+
+            std::mt19937 m_rnd;
+        };
+
+        void fail(const std::string& message)
+        {
+            std::cerr << message << std::endl;
+            std::abort();
+        }
+    }
+
+    // Engines ------------------------------------------------------------------------------------------------
+
+    ConsoleEngine::ConsoleEngine(const std::string& name) : Engine(name), m_console(m_storage)
+    {
+        m_storage.defineProperty("str", Storage::PropertyType::Type_String);
+        m_storage.defineProperty("number", Storage::PropertyType::Type_Int32);
+        m_storage.defineProperty("very_long", Storage::PropertyType::Type_Int64);
+        m_storage.defineProperty("dbl", Storage::PropertyType::Type_Double);
+    }
+
+    std::string ConsoleEngine::execute(const std::string& line)
+    {
+        std::ostringstream out;
+        m_console.ProcessLine(out, line);
+        return out.str();
+    }
+
+    std::string VersionedEngine::execute(const std::string& line)
+    {
+        std::string result = ConsoleEngine::execute(line);
+        if (++m_commands % ReloadPeriod == 0)
+            reload();
+        return result;
+    }
+
+    bool VersionedEngine::check(std::string& error)
+    {
+        if (!m_error.empty())
+        {
+            error = m_error;
+            return false;
+        }
+
+        // Batch lookup has to agree with getProperty
+        std::vector<std::string_view> names(std::begin(PropertyNames), std::end(PropertyNames));
+        std::vector<const Storage::Property*> values = m_storage.getMany(names);
+        for (size_t i = 0; i < names.size(); ++i)
+        {
+            if (values[i] != m_storage.getProperty(PropertyNames[i]))
+            {
+                error = "getMany differs from getProperty for \"" + std::string(names[i]) + "\"";
+                return false;
+            }
+        }
+
+        // Latest version has to be the same as the live storage
+        Storage::PropertyStorage snapshot;
+        if (m_storage.currentVersion() > 0 && !m_storage.snapshotAt(m_storage.currentVersion(), snapshot))
+        {
+            error = "Latest version is not retained";
+            return false;
+        }
+
+        std::ostringstream live, versioned;
+        live << m_storage;
+        versioned << snapshot;
+        if (live.str() != versioned.str())
+        {
+            error = "Latest version differs from the storage:\n" + versioned.str() + "storage:\n" + live.str();
+            return false;
+        }
+        return true;
+    }
+
+    void VersionedEngine::reload()
+    {
+        std::stringstream data;
+        if (!m_storage.saveStorage(data, m_commands / ReloadPeriod % 2 == 0) || !m_storage.loadStorage(data))
+            m_error = "Snapshot reload failed: " + m_storage.getLastError();
+    }
+
+    // --------------------------------------------------------------------------------------------------------
+
+    void FuzzOne(const unsigned char* data, size_t size, const EngineFactory& candidate)
+    {
+        const size_t maxLines = 1000;
+        std::string text(reinterpret_cast<const char*>(data), size);
+
+        // Input as console commands
+        {
+            ReferenceEngine reference;
+            std::unique_ptr<Engine> tested(candidate());
+            std::istringstream in(text);
+            std::string line, error;
+
+            for (size_t i = 0; i < maxLines && std::getline(in, line); ++i)
+            {
+                std::string cmn_name = Frozen::commandName(line);
+                if (cmn_name == "SAVE" || cmn_name == "LOAD")
+                    continue;
+                if (!isCompared(line))
+                {
+                    tested->execute(line);
+                    continue;
+                }
+
+                std::string expected = reference.execute(line);
+                std::string actual = tested->execute(line);
+                if (expected != actual)
+                    fail("Output mismatch for \"" + line + "\":\n" + expected + "---\n" + actual);
+                if (!tested->check(error))
+                    fail("Check failed after \"" + line + "\": " + error);
+            }
+        }
+
+        // Input as a storage file: whatever was loaded has to survive save/load
+        {
+            Storage::PropertyStorage st;
+            std::istringstream in(text);
+            if (st.loadStorage(in))
+            {
+                std::ostringstream expected;
+                expected << st;
+
+                for (bool compress : { false, true })
+                {
+                    std::stringstream data;
+                    Storage::PropertyStorage copy;
+                    if (!st.saveStorage(data, compress) || !copy.loadStorage(data))
+                        fail("Cannot reload storage: " + copy.getLastError());
+
+                    std::ostringstream actual;
+                    actual << copy;
+                    if (expected.str() != actual.str())
+                        fail("Storage differs after reload:\n" + expected.str() + "---\n" + actual.str());
+                }
+            }
+        }
+    }
+
+    int RunDifferential(std::ostream& out, size_t command_count, unsigned seed, const EngineFactory& candidate, double min_speed)
+    {
+        using Clock = std::chrono::steady_clock;
+
+        CommandGenerator generator(seed);
+        std::vector<std::string> commands(command_count);
+        for (auto& cmd : commands)
+            cmd = generator.next();
+
+        out << "Differential run: " << command_count << " commands, seed " << seed << std::endl;
+
+        // Timed runs
+        ReferenceEngine reference;
+        std::unique_ptr<Engine> tested(candidate());
+        std::vector<std::string> expected(command_count), actual(command_count);
+
+        auto start = Clock::now();
+        for (size_t i = 0; i < command_count; ++i)
+            expected[i] = reference.execute(commands[i]);
+        double referenceSec = std::chrono::duration<double>(Clock::now() - start).count();
+
+        start = Clock::now();
+        for (size_t i = 0; i < command_count; ++i)
+            actual[i] = tested->execute(commands[i]);
+        double testedSec = std::chrono::duration<double>(Clock::now() - start).count();
+
+        for (size_t i = 0; i < command_count; ++i)
+        {
+            if (isCompared(commands[i]) && expected[i] != actual[i])
+            {
+                out << "MISMATCH at command " << i << ": \"" << commands[i] << "\"" << std::endl
+                    << reference.getName() << ":" << std::endl << expected[i]
+                    << tested->getName() << ":" << std::endl << actual[i];
+                return 1;
+            }
+        }
+
+        // Consistency checks after every command (not timed)
+        std::unique_ptr<Engine> checked(candidate());
+        std::string error;
+        for (size_t i = 0; i < command_count; ++i)
+        {
+            checked->execute(commands[i]);
+            if (!checked->check(error))
+            {
+                out << "CHECK FAILED at command " << i << ": \"" << commands[i] << "\"" << std::endl << error << std::endl;
+                return 1;
+            }
+        }
+
+        double ratio = referenceSec / testedSec;
+        out << std::setw(20) << "engine" << std::setw(16) << "commands/s" << std::endl;
+        out << std::setw(20) << reference.getName() << std::setw(16) << std::fixed << std::setprecision(0) << command_count / referenceSec << std::endl;
+        out << std::setw(20) << tested->getName() << std::setw(16) << command_count / testedSec
+            << "  (" << std::setprecision(2) << ratio << "x)" << std::endl;
+
+        if (min_speed > 0 && ratio < min_speed)
+        {
+            out << "TOO SLOW: " << tested->getName() << " runs at " << ratio << "x of the reference speed, required " << min_speed << "x" << std::endl;
+            return 1;
+        }
+        out << "OK: outputs are identical" << std::endl;
+        return 0;
+    }
+}
+
+#ifdef PROPSTORAGE_FUZZER
+
+extern "C" int LLVMFuzzerTestOneInput(const unsigned char* data, size_t size)
+{
+    Fuzz::FuzzOne(data, size, []() -> Fuzz::Engine* { return new Fuzz::VersionedEngine(); });
+    return 0;
+}
+
+#endif
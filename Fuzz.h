@@ -0,0 +1,84 @@
+#pragma once
+#include <iostream>
+#include <functional>
+#include "PropertiesStorage.h"
+#include "Console.h"
+
+namespace Fuzz
+{
+    // Fuzzing of the console parser and the storage.
+    //
+    // libFuzzer: build all sources except PropStorage.cpp main with "-fsanitize=fuzzer -DPROPSTORAGE_FUZZER",
+    //            LLVMFuzzerTestOneInput runs the input as console commands and as a storage file.
+    // Differential: "PropStorage.exe --fuzz [commands] [seed] [min_speed]" runs a random command stream on the reference
+    //            engine and on the engine under test, compares every output and reports throughput of both.
+    //
+    // The reference engine is a frozen copy of the console parsing and command semantics over a plain std::map
+    // (it shares no code with Console and the storage), so it catches parser changes as well.
+    // Versioned reads ("GETAT", "VERSION"), "SAVE" and "LOAD" are not modeled and not compared.
+
+    // Engine executes console command lines and returns their output
+
+    class Engine
+    {
+    public:
+
+        Engine(const std::string& name) : m_name(name) { }
+        virtual ~Engine() { }
+
+        std::string getName() const { return m_name; }
+
+        virtual std::string execute(const std::string& line) = 0;
+
+        // Consistency check of the engine state after a command
+        virtual bool check(std::string&) { return true; }
+
+    protected:
+
+        std::string m_name;
+    };
+
+    // Console over its own storage with the same predefined properties as in main()
+
+    class ConsoleEngine : public Engine
+    {
+    public:
+
+        ConsoleEngine(const std::string& name = "console");
+
+        std::string execute(const std::string& line) override;
+
+    protected:
+
+        Storage::PropertyStorage m_storage;
+        Console m_console;
+    };
+
+    // Versioned storage which is periodically replaced by its own snapshot (compressed and not compressed by turns)
+
+    class VersionedEngine : public ConsoleEngine
+    {
+    public:
+
+        VersionedEngine() : ConsoleEngine("versioned+reload") { m_storage.enableVersioning(4); }
+
+        std::string execute(const std::string& line) override;
+        bool check(std::string& error) override;
+
+    private:
+
+        static const size_t ReloadPeriod = 16;
+
+        void reload();
+
+        size_t m_commands = 0;
+        std::string m_error;
+    };
+
+    using EngineFactory = std::function<Engine*()>;    // creates a new engine under test (caller deletes it)
+
+    void FuzzOne(const unsigned char* data, size_t size, const EngineFactory& candidate);
+
+    // min_speed > 0 fails the run if the engine under test is slower than min_speed * reference speed
+    int RunDifferential(std::ostream& out, size_t command_count, unsigned seed, const EngineFactory& candidate, double min_speed = 0);
+}
@@ -1,7 +1,25 @@
 #include "Console.h"
+#include "Benchmark.h"
+#include "Fuzz.h"
 
-int main()
+#ifndef PROPSTORAGE_FUZZER
+
+int main(int argc, char* argv[])
 {
+    if (argc > 1 && std::string(argv[1]) == "--bench")
+    {
+        Bench::RunAll(std::cout);
+        return 0;
+    }
+
+    if (argc > 1 && std::string(argv[1]) == "--fuzz")
+    {
+        size_t commands = argc > 2 ? std::stoul(argv[2]) : 100000;
+        unsigned seed = argc > 3 ? std::stoul(argv[3]) : 1;
+        double min_speed = argc > 4 ? std::stod(argv[4]) : 0;
+        return Fuzz::RunDifferential(std::cout, commands, seed, []() -> Fuzz::Engine* { return new Fuzz::VersionedEngine(); }, min_speed);
+    }
+
     Storage::PropertyStorage st("alfa");
     
     // It is not nesessary but we can predefine some properties
@@ -25,9 +43,25 @@ int main()
     //         2) Define "setDefaultValue", "toString" and "fromString" functions for VariantValue template class for a new type.
     //         3) Add new type to "PropertyStorage::createProperty" function.
 
+    // Note 5: Versioning is enabled, so every change creates a new version of the property (last 8 versions are kept).
+    //         Use "VERSION" command to see the current version, "GETAT properyName@version" and "GETAT *@version" to read old values.
+    //         Run "PropStorage.exe --bench" for benchmarks and "PropStorage.exe --fuzz [commands] [seed] [min_speed]" for a differential fuzz run.
+
+    // Note 6: "SAVE fileName" and "LOAD fileName" commands save/load the storage in compressed binary format
+    //         (prefix compressed names, varint/delta numbers and LZ77 blocks, see StorageCodec.h).
+
+    // Note 7: Storage::AsyncStorage (AsyncStorage.h) is an awaitable API of the storage for C++20 coroutines.
+
+    // Note 8: Fuzz.cpp has a libFuzzer entry point (build with -fsanitize=fuzzer -DPROPSTORAGE_FUZZER).
+
+    // Note 9: "MGET properyName1 properyName2 ..." reads several properties with one batch lookup (PropertyStorage::getMany).
+
+    st.enableVersioning(8);
+
     Console con(st);
     con.Run(std::cin, std::cout);
 
     return 0;
 }
 
+#endif
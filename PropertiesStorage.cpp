@@ -1,5 +1,14 @@
 #include <iomanip>
+#include <algorithm>
+#include <thread>
+#include <fstream>
+#include <cstring>
+#include <limits>
+#if defined(_MSC_VER)
+#include <xmmintrin.h>
+#endif
 #include "PropertiesStorage.h"
+#include "StorageCodec.h"
 #include "Auxiliary.h"
 
 namespace Storage
@@ -123,6 +132,158 @@ namespace Storage
         return false;
     }
 
+    // PropertyIndex functions -------------------------------------------------------------------------------------
+
+#if defined(_MSC_VER)
+#define PREFETCH(p) _mm_prefetch(reinterpret_cast<const char*>(p), _MM_HINT_T0)
+#else
+#define PREFETCH(p) __builtin_prefetch(p)
+#endif
+
+    UInt64 PropertyIndex::hashOf(std::string_view key)
+    {
+        // FNV-1a with a final mix, since only the low bits select a slot
+        UInt64 h = 14695981039346656037ull;
+        for (unsigned char c : key)
+        {
+            h ^= c;
+            h *= 1099511628211ull;
+        }
+        return h ^ (h >> 32);
+    }
+
+    void PropertyIndex::grow()
+    {
+        std::vector<Slot> old;
+        old.swap(m_slots);
+        m_slots.resize(old.empty() ? 16 : old.size() * 2);
+
+        for (const auto& slot : old)
+        {
+            if (!slot.key)
+                continue;
+
+            size_t i = slotOf(slot.hash);
+            while (m_slots[i].key)
+                i = (i + 1) & (m_slots.size() - 1);
+            m_slots[i] = slot;
+        }
+    }
+
+    void PropertyIndex::insert(const std::string& key, Property* value)
+    {
+        // Load factor is kept under 1/2
+        if ((m_count + 1) * 2 > m_slots.size())
+            grow();
+
+        UInt64 hash = hashOf(key);
+        size_t i = slotOf(hash);
+        while (m_slots[i].key)
+            i = (i + 1) & (m_slots.size() - 1);
+
+        m_slots[i].hash = hash;
+        m_slots[i].key = &key;
+        m_slots[i].value = value;
+        ++m_count;
+    }
+
+    void PropertyIndex::erase(const std::string& key)
+    {
+        if (m_slots.empty())
+            return;
+
+        UInt64 hash = hashOf(key);
+        size_t mask = m_slots.size() - 1;
+        size_t i = slotOf(hash);
+        while (m_slots[i].key && (m_slots[i].hash != hash || *m_slots[i].key != key))
+            i = (i + 1) & mask;
+        if (!m_slots[i].key)
+            return;
+
+        // Backward shift: move up every following slot that would not be found behind the hole
+        for (size_t j = (i + 1) & mask; m_slots[j].key; j = (j + 1) & mask)
+        {
+            size_t ideal = slotOf(m_slots[j].hash);
+            if (((j - ideal) & mask) >= ((j - i) & mask))
+            {
+                m_slots[i] = m_slots[j];
+                i = j;
+            }
+        }
+        m_slots[i] = Slot();
+        --m_count;
+    }
+
+    void PropertyIndex::rebuild(const PropertyMap& props)
+    {
+        clear();
+        for (const auto& it : props)
+            insert(it.first, it.second);
+    }
+
+    void PropertyIndex::findMany(const std::string_view* keys, const Property** values, size_t count) const
+    {
+        // Keys are resolved by batches in three passes, so cache misses of a batch overlap:
+        // hash all keys and prefetch their slots, find slots with matching hashes and prefetch keys and values,
+        // then compare keys.
+        if (m_slots.empty())
+        {
+            std::fill(values, values + count, nullptr);
+            return;
+        }
+
+        size_t mask = m_slots.size() - 1;
+        UInt64 hashes[BatchSize];
+        size_t slots[BatchSize];
+
+        for (size_t first = 0; first < count; first += BatchSize)
+        {
+            size_t n = std::min(BatchSize, count - first);
+
+            for (size_t i = 0; i < n; ++i)
+            {
+                hashes[i] = hashOf(keys[first + i]);
+                PREFETCH(&m_slots[slotOf(hashes[i])]);
+            }
+
+            for (size_t i = 0; i < n; ++i)
+            {
+                size_t s = slotOf(hashes[i]);
+                while (m_slots[s].key && m_slots[s].hash != hashes[i])
+                    s = (s + 1) & mask;
+
+                if (m_slots[s].key)
+                {
+                    PREFETCH(m_slots[s].key);
+                    PREFETCH(m_slots[s].value);
+                }
+                slots[i] = s;
+            }
+
+            for (size_t i = 0; i < n; ++i)
+            {
+                size_t s = slots[i];
+                while (m_slots[s].key && (m_slots[s].hash != hashes[i] || *m_slots[s].key != keys[first + i]))
+                    s = (s + 1) & mask;
+
+                values[first + i] = m_slots[s].key ? m_slots[s].value : nullptr;
+            }
+        }
+    }
+
+    const Property* PropertyIndex::find(std::string_view key) const
+    {
+        if (m_slots.empty())
+            return nullptr;
+
+        UInt64 hash = hashOf(key);
+        size_t s = slotOf(hash);
+        while (m_slots[s].key && (m_slots[s].hash != hash || *m_slots[s].key != key))
+            s = (s + 1) & (m_slots.size() - 1);
+
+        return m_slots[s].key ? m_slots[s].value : nullptr;
+    }
+
     // PropertyStorage functions -----------------------------------------------------------------------------------
 
 #define GET_PROP(f) \
@@ -184,6 +345,7 @@ namespace Storage
     if (it == m_propStorage.end()) { m_lastError = "Property not defined"; return false; } \
     if (it->second->getType() != PropertyType::type) { m_lastError = "Type mismatch"; return false; } \
     dynamic_cast<Storage::PropValue<class_name>*>(it->second)->set(val); \
+    propertyChanged(prop_name, it->second); \
     return true;
 
     bool PropertyStorage::setProp(const std::string& prop_name, const String& val) 
@@ -256,12 +418,37 @@ namespace Storage
         return nullptr;
     }
 
+    Property* PropertyStorage::cloneProperty(const Property* p)
+    {
+        if (!p)
+            return nullptr;
+
+        Property* clone = createProperty(p->getType());
+        if (clone && !clone->copy(p))
+        {
+            delete clone;
+            clone = nullptr;
+        }
+        return clone;
+    }
+
     bool PropertyStorage::defineProperty(const std::string &prop_name, PropertyType prop_type)
+    {
+        return addProperty(prop_name, createProperty(prop_type));
+    }
+
+    bool PropertyStorage::defineProperty(const std::string& prop_name, const Property* value)
+    {
+        return addProperty(prop_name, cloneProperty(value));
+    }
+
+    bool PropertyStorage::addProperty(const std::string& prop_name, Property* p)
     {
         m_lastError.clear();
         if (prop_name.empty())
         {
             m_lastError = "Empty property name";
+            delete p;
             return false;
         }
 
@@ -269,17 +456,19 @@ namespace Storage
         if (it != m_propStorage.end())
         {
             m_lastError = "Attempt property redefinition";
+            delete p;
             return false;
         }
 
-        Property *p = createProperty(prop_type);
         if (!p)
         {
             m_lastError = "Wrong property type";
             return false;
         }
 
-        m_propStorage[prop_name] = p;
+        it = m_propStorage.emplace(prop_name, p).first;
+        m_propIndex.insert(it->first, p);
+        propertyChanged(prop_name, p);
         return true;
     }
 
@@ -294,13 +483,23 @@ namespace Storage
         return nullptr;
     }
 
+    std::vector<const Property*> PropertyStorage::getMany(std::span<const std::string_view> prop_names) const
+    {
+        std::vector<const Property*> values(prop_names.size(), nullptr);
+        m_propIndex.findMany(prop_names.data(), values.data(), prop_names.size());
+        return values;
+    }
+
     bool PropertyStorage::deleteProperty(const std::string& prop_name)
     {
         m_lastError.clear();
         PropertyMap::const_iterator it = m_propStorage.find(prop_name);
         if (it != m_propStorage.end())
         {
+            delete it->second;
+            m_propIndex.erase(it->first);
             m_propStorage.erase(it);
+            propertyChanged(prop_name, nullptr);
             return true;
         }
 
@@ -342,9 +541,17 @@ namespace Storage
             return false;
         }
 
+        propertyChanged(prop_name, it->second);
         return true;
     }
 
+    void PropertyStorage::propertyChanged(const std::string& prop_name, const Property* p)
+    {
+        publishVersion(prop_name, p);
+        if (m_changeListener)
+            m_changeListener(prop_name);
+    }
+
     void PropertyStorage::operator= (const PropertyStorage& rVal)
     {
         for (auto& it : m_propStorage)
@@ -353,34 +560,631 @@ namespace Storage
             it.second = nullptr;
         }
         m_propStorage.clear();
+        m_propIndex.clear();
+        clearVersions();
 
         m_storageName = rVal.m_storageName;
         m_lastError.clear();
 
         for (auto& it : rVal.m_propStorage)
         {
-            if (defineProperty(it.first, it.second->getType()))
-                setProperty(it.first, it.second);
+            defineProperty(it.first, it.second);
         }
     }
 
-    bool PropertyStorage::saveStorage() const
+    // Storage format: "PSTG", format version, flags and records sorted by name (written through CodecWriter):
+    // { type, varint shared prefix length with the previous name, varint suffix length, suffix, value }..., Type_Unknown
+    // String value is varint length + bytes, Int32/Int64 are zigzag varints of the delta from the previous value
+    // of the same type, Double is 8 bytes of its binary representation (little endian).
+
+    static const char StorageMagic[4] = { 'P', 'S', 'T', 'G' };
+    static const unsigned char StorageFormatVersion = 1;
+    static const unsigned char StorageFlagCompressed = 1;
+
+    bool PropertyStorage::saveStorage(const std::string& file_name, bool compress) const
+    {
+        m_lastError.clear();
+        std::ofstream out(file_name, std::ios::binary | std::ios::trunc);
+        if (!out.is_open())
+        {
+            m_lastError = "Cannot open file";
+            return false;
+        }
+        return saveStorage(out, compress);
+    }
+
+    bool PropertyStorage::loadStorage(const std::string& file_name)
+    {
+        m_lastError.clear();
+        std::ifstream in(file_name, std::ios::binary);
+        if (!in.is_open())
+        {
+            m_lastError = "Cannot open file";
+            return false;
+        }
+        return loadStorage(in);
+    }
+
+    bool PropertyStorage::saveStorage(std::ostream& out, bool compress) const
     {
-        // Save storage to file or DB
+        m_lastError.clear();
+        out.write(StorageMagic, sizeof(StorageMagic));
+        out.put(static_cast<char>(StorageFormatVersion));
+        out.put(static_cast<char>(compress ? StorageFlagCompressed : 0));
+
+        CodecWriter writer(out, compress);
+        const std::string* prev_name = nullptr;
+        Int32 prev_int32 = 0;
+        Int64 prev_int64 = 0;
+
+        for (const auto& it : m_propStorage)
+        {
+            const std::string& name = it.first;
+            size_t shared = 0;
+            if (prev_name)
+            {
+                size_t max_shared = std::min(name.size(), prev_name->size());
+                while (shared < max_shared && name[shared] == (*prev_name)[shared])
+                    ++shared;
+            }
+            prev_name = &name;
+
+            PropertyType type = it.second->getType();
+            writer.putByte(static_cast<unsigned char>(type));
+            writer.putVarint(shared);
+            writer.putVarint(name.size() - shared);
+            writer.write(name.data() + shared, name.size() - shared);
+
+            if (type == PropertyType::Type_String)
+            {
+                String val = dynamic_cast<const PropValue<String>*>(it.second)->get();
+                writer.putVarint(val.size());
+                writer.write(val.data(), val.size());
+            }
+            else if (type == PropertyType::Type_Int32)
+            {
+                Int32 val = dynamic_cast<const PropValue<Int32>*>(it.second)->get();
+                writer.putVarint(zigzagEncode(static_cast<Int64>(val) - prev_int32));
+                prev_int32 = val;
+            }
+            else if (type == PropertyType::Type_Int64)
+            {
+                Int64 val = dynamic_cast<const PropValue<Int64>*>(it.second)->get();
+                writer.putVarint(zigzagEncode(static_cast<Int64>(static_cast<UInt64>(val) - static_cast<UInt64>(prev_int64))));
+                prev_int64 = val;
+            }
+            else if (type == PropertyType::Type_Double)
+            {
+                Double val = dynamic_cast<const PropValue<Double>*>(it.second)->get();
+                UInt64 bits;
+                memcpy(&bits, &val, sizeof(bits));
+                for (int i = 0; i < 8; ++i, bits >>= 8)
+                    writer.putByte(static_cast<unsigned char>(bits));
+            }
+        }
+        writer.putByte(static_cast<unsigned char>(PropertyType::Type_Unknown));
+
+        if (!writer.finish())
+        {
+            m_lastError = "Write error";
+            return false;
+        }
+        return true;
+    }
+
+    bool PropertyStorage::loadStorage(std::istream& in)
+    {
+        m_lastError.clear();
+
+        char magic[sizeof(StorageMagic)];
+        in.read(magic, sizeof(magic));
+        int version = in.get();
+        int flags = in.get();
+        if (!in || memcmp(magic, StorageMagic, sizeof(magic)) != 0 || version != StorageFormatVersion || (flags & ~StorageFlagCompressed))
+        {
+            m_lastError = "Wrong storage format";
+            return false;
+        }
+
+        // Read everything into a temporary storage first, so a broken file does not change this one
+        PropertyStorage loaded;
+        CodecReader reader(in, (flags & StorageFlagCompressed) != 0);
+        std::string name, suffix;
+        Int32 prev_int32 = 0;
+        Int64 prev_int64 = 0;
+        bool complete = false;
+
+        for (;;)
+        {
+            unsigned char type;
+            UInt64 shared, suffix_len;
+            if (!reader.getByte(type))
+                break;
+            if (type == static_cast<unsigned char>(PropertyType::Type_Unknown))
+            {
+                complete = true;
+                break;
+            }
+
+            if (!reader.getVarint(shared) || shared > name.size() || !reader.getVarint(suffix_len) ||
+                suffix_len > suffix.max_size() || !reader.read(suffix, static_cast<size_t>(suffix_len)))
+                break;
+            name.resize(static_cast<size_t>(shared));
+            name += suffix;
+            if (name.empty())
+                break;
+
+            Property* p = createProperty(static_cast<PropertyType>(type));
+            if (!p)
+                break;
+
+            bool ok = true;
+            UInt64 n = 0;
+            if (p->getType() == PropertyType::Type_String)
+            {
+                String val;
+                ok = reader.getVarint(n) && n <= val.max_size() && reader.read(val, static_cast<size_t>(n));
+                dynamic_cast<PropValue<String>*>(p)->set(val);
+            }
+            else if (p->getType() == PropertyType::Type_Int32)
+            {
+                ok = reader.getVarint(n) && n <= 0xFFFFFFFF * 2ull;
+                Int64 val = ok ? static_cast<Int64>(prev_int32) + zigzagDecode(n) : 0;
+                ok = ok && val >= std::numeric_limits<Int32>::min() && val <= std::numeric_limits<Int32>::max();
+                prev_int32 = static_cast<Int32>(val);
+                dynamic_cast<PropValue<Int32>*>(p)->set(prev_int32);
+            }
+            else if (p->getType() == PropertyType::Type_Int64)
+            {
+                ok = reader.getVarint(n);
+                prev_int64 = static_cast<Int64>(static_cast<UInt64>(prev_int64) + static_cast<UInt64>(zigzagDecode(n)));
+                dynamic_cast<PropValue<Int64>*>(p)->set(prev_int64);
+            }
+            else if (p->getType() == PropertyType::Type_Double)
+            {
+                UInt64 bits = 0;
+                unsigned char c;
+                for (int i = 0; i < 8 && ok; ++i)
+                {
+                    ok = reader.getByte(c);
+                    bits |= static_cast<UInt64>(c) << (8 * i);
+                }
+                Double val;
+                memcpy(&val, &bits, sizeof(val));
+                dynamic_cast<PropValue<Double>*>(p)->set(val);
+            }
+
+            // Names are written sorted, so this check also rejects duplicates
+            if (!ok || (!loaded.m_propStorage.empty() && !(loaded.m_propStorage.rbegin()->first < name)))
+            {
+                delete p;
+                break;
+            }
+            loaded.m_propStorage.emplace_hint(loaded.m_propStorage.end(), name, p);
+        }
+
+        // Nothing may follow the terminator
+        if (!complete || !reader.atEnd())
+        {
+            m_lastError = "Corrupted storage data";
+            return false;
+        }
+
+        return replaceContent(loaded);
+    }
+
+    bool PropertyStorage::replaceContent(PropertyStorage& source)
+    {
+        m_lastError.clear();
+        if (m_propStorage.empty() && !isVersioningEnabled() && !m_changeListener)
+        {
+            m_propStorage.swap(source.m_propStorage);
+            source.m_propIndex.rebuild(source.m_propStorage);
+            m_propIndex.rebuild(m_propStorage);
+            return true;
+        }
+
+        // Replace content through usual functions, so versioning and the listener see every change.
+        // Unchanged properties are skipped. The load is not atomic for versioned readers: every change
+        // gets its own version, so a reader can see a mix of the old and the loaded content.
+        std::vector<std::string> removed;
+        for (const auto& it : m_propStorage)
+        {
+            const Property* p = source.getProperty(it.first);
+            if (!p || p->getType() != it.second->getType())
+                removed.push_back(it.first);
+        }
+        for (const auto& it : removed)
+            deleteProperty(it);
 
-        // TO DO
-        // It was out of my task scope 
+        for (const auto& it : source.m_propStorage)
+        {
+            PropertyMap::iterator existing = m_propStorage.find(it.first);
+            if (existing == m_propStorage.end())
+            {
+                if (!defineProperty(it.first, it.second))
+                    return false;
+            }
+            else if (!(*existing->second == it.second) && !setProperty(it.first, it.second))
+                return false;
+        }
 
+        m_lastError.clear();
         return true;
     }
 
-    bool PropertyStorage::loadStorage()
+    // Versioning (MVCC) functions ---------------------------------------------------------------------------
+
+    // Writer publishes a node first and advances the global version after it, so a reader that sees
+    // version N finds every node with version <= N already linked.
+    // Unlinked nodes are retired with the version current at the moment of unlinking and deleted only
+    // when every active reader has pinned a newer version (such readers cannot reach unlinked nodes).
+    // Chain tables are retired the same way: a reader pins its version before it loads the table pointer.
+
+    VersionChain::~VersionChain()
+    {
+        PropVersion* node = head.load();
+        while (node)
+        {
+            PropVersion* older = node->next.load();
+            delete node;
+            node = older;
+        }
+    }
+
+    const VersionChain* PropertyStorage::findChain(const VersionTable* table, const std::string& prop_name)
     {
-        // Load storage from file or DB
+        if (!table)
+            return nullptr;
+
+        UInt64 hash = PropertyIndex::hashOf(prop_name);
+        size_t mask = table->slots.size() - 1;
+        for (size_t s = static_cast<size_t>(hash) & mask; ; s = (s + 1) & mask)
+        {
+            const VersionChain* chain = table->slots[s].load();
+            if (!chain || (chain->hash == hash && chain->name == prop_name))
+                return chain;
+        }
+    }
+
+    void PropertyStorage::insertChain(VersionTable& table, VersionChain* chain)
+    {
+        size_t mask = table.slots.size() - 1;
+        size_t s = static_cast<size_t>(chain->hash) & mask;
+        while (table.slots[s].load())
+            s = (s + 1) & mask;
+
+        table.slots[s].store(chain);
+        ++table.count;
+    }
+
+    VersionChain* PropertyStorage::chainOf(const std::string& prop_name)
+    {
+        // Writer side (under m_writeLock): a new chain is published by a single store into a free slot
+        VersionChain* chain = const_cast<VersionChain*>(findChain(m_versions.load(), prop_name));
+        if (chain)
+            return chain;
+
+        VersionTable* table = m_versions.load();
+        if (!table || (table->count + 1) * 2 > table->slots.size())
+        {
+            rebuildVersions();
+            table = m_versions.load();
+        }
+
+        chain = new VersionChain(prop_name, PropertyIndex::hashOf(prop_name));
+        insertChain(*table, chain);
+        return chain;
+    }
+
+    void PropertyStorage::rebuildVersions()
+    {
+        // New table with room for twice as many chains (without dropped ones) replaces the current one
+        VersionTable* old = m_versions.load();
+        size_t count = 0;
+        if (old)
+        {
+            for (const auto& slot : old->slots)
+            {
+                VersionChain* chain = slot.load();
+                count += chain && !chain->dropped;
+            }
+        }
 
-        // TO DO
-        // It was out of my task scope 
+        size_t size = 16;
+        while (size < (count + 1) * 4)
+            size *= 2;
 
+        VersionTable* table = new VersionTable(size);
+        if (old)
+        {
+            for (const auto& slot : old->slots)
+            {
+                VersionChain* chain = slot.load();
+                if (chain && !chain->dropped)
+                    insertChain(*table, chain);
+            }
+        }
+        m_versions.store(table);
+
+        if (old)
+            m_retiredTables.emplace_back(m_version.load(), old);
+    }
+
+    bool PropertyStorage::enableVersioning(size_t retention_depth)
+    {
+        std::lock_guard<std::mutex> guard(m_writeLock);
+
+        if (retention_depth == 0)
+        {
+            m_retentionDepth = 0;
+            clearVersions();
+            return true;
+        }
+
+        if (m_retentionDepth == 0)
+        {
+            // Seed version chains with current values (all of them get the same version)
+            Version version = m_version.load() + 1;
+            for (const auto& it : m_propStorage)
+            {
+                std::atomic<PropVersion*>& head = chainOf(it.first)->head;
+                head.store(new PropVersion(version, cloneProperty(it.second), head.load()));
+            }
+            m_version.store(version);
+        }
+
+        m_retentionDepth = retention_depth;
         return true;
     }
+
+    void PropertyStorage::publishVersion(const std::string& prop_name, const Property* p)
+    {
+        if (!isVersioningEnabled())
+            return;
+
+        std::lock_guard<std::mutex> guard(m_writeLock);
+
+        std::atomic<PropVersion*>& head = chainOf(prop_name)->head;
+
+        Version version = m_version.load() + 1;
+        head.store(new PropVersion(version, cloneProperty(p), head.load()));
+        m_version.store(version);
+
+        trimChain(head);
+        reclaimRetired();
+    }
+
+    void PropertyStorage::trimChain(std::atomic<PropVersion*>& head)
+    {
+        // Keep "retention depth" newest nodes and everything that is still visible for the oldest pinned reader
+        Version oldest = oldestPinnedVersion();
+        size_t kept = 0;
+
+        for (PropVersion* node = head.load(); node; node = node->next.load())
+        {
+            PropVersion* older = node->next.load();
+            if (++kept >= m_retentionDepth && node->version <= oldest && older)
+            {
+                // Flag goes first: a reader that sees the cut also sees the flag
+                node->trimmed.store(true);
+                node->next.store(nullptr);
+
+                Version retired = m_version.load();
+                for (; older; older = older->next.load())
+                    m_retired.emplace_back(retired, older);
+                break;
+            }
+        }
+    }
+
+    template<class T> static void reclaim(std::vector<std::pair<Version, T*>>& retired, Version oldest)
+    {
+        auto it = std::partition(retired.begin(), retired.end(),
+                                 [oldest](const std::pair<Version, T*>& r) { return r.first >= oldest; });
+
+        for (auto del = it; del != retired.end(); ++del)
+            delete del->second;
+        retired.erase(it, retired.end());
+    }
+
+    void PropertyStorage::reclaimRetired()
+    {
+        if (m_retired.empty() && m_retiredTables.empty() && m_retiredChains.empty())
+            return;
+
+        Version oldest = oldestPinnedVersion();
+        reclaim(m_retired, oldest);
+        reclaim(m_retiredTables, oldest);
+        reclaim(m_retiredChains, oldest);
+    }
+
+    void PropertyStorage::collectGarbage()
+    {
+        std::lock_guard<std::mutex> guard(m_writeLock);
+        if (VersionTable* table = m_versions.load())
+        {
+            // Chain of a deleted property is dropped when every reader already sees the deletion.
+            // Readers of older versions cannot tell a dropped chain from a never defined property,
+            // so they report such misses as "not retained".
+            Version oldest = oldestPinnedVersion();
+            bool dropped = false;
+            for (auto& slot : table->slots)
+            {
+                VersionChain* chain = slot.load();
+                if (!chain)
+                    continue;
+
+                trimChain(chain->head);
+                PropVersion* head = chain->head.load();
+                if (head && !head->value && head->version < oldest)
+                {
+                    if (head->version > m_droppedVersion.load())
+                        m_droppedVersion.store(head->version);
+                    chain->dropped = true;
+                    dropped = true;
+                }
+            }
+
+            if (dropped)
+            {
+                rebuildVersions();
+                for (auto& slot : table->slots)
+                {
+                    VersionChain* chain = slot.load();
+                    if (chain && chain->dropped)
+                        m_retiredChains.emplace_back(m_version.load(), chain);
+                }
+            }
+        }
+        reclaimRetired();
+    }
+
+    void PropertyStorage::clearVersions()
+    {
+        // Not safe with active readers
+        if (VersionTable* table = m_versions.load())
+        {
+            for (auto& slot : table->slots)
+                delete slot.load();
+            delete table;
+        }
+        m_versions.store(nullptr);
+
+        reclaim(m_retired, std::numeric_limits<Version>::max());
+        reclaim(m_retiredTables, std::numeric_limits<Version>::max());
+        reclaim(m_retiredChains, std::numeric_limits<Version>::max());
+        m_droppedVersion.store(m_version.load());
+    }
+
+    size_t PropertyStorage::pinReader(Version version) const
+    {
+        for (;;)
+        {
+            for (size_t i = 0; i < MaxReaders; ++i)
+            {
+                Version expected = 0;
+                if (m_readerPins[i].load(std::memory_order_relaxed) == 0 && m_readerPins[i].compare_exchange_strong(expected, version))
+                    return i;
+            }
+            std::this_thread::yield();
+        }
+    }
+
+    Version PropertyStorage::oldestPinnedVersion() const
+    {
+        // Returns a version newer than any existing one if there are no active readers
+        Version oldest = m_version.load() + 1;
+        for (size_t i = 0; i < MaxReaders; ++i)
+        {
+            Version pinned = m_readerPins[i].load();
+            if (pinned != 0 && pinned < oldest)
+                oldest = pinned;
+        }
+        return oldest;
+    }
+
+    VersionStatus PropertyStorage::findVersion(const std::atomic<PropVersion*>& head, Version version, const Property*& value)
+    {
+        value = nullptr;
+        for (const PropVersion* node = head.load(); node; )
+        {
+            if (node->version <= version)
+            {
+                value = node->value;
+                return value ? VersionStatus::Status_Found : VersionStatus::Status_NotDefined;
+            }
+
+            const PropVersion* older = node->next.load();
+            if (!older && node->trimmed.load())
+                return VersionStatus::Status_NotRetained;
+            node = older;
+        }
+        return VersionStatus::Status_NotDefined;
+    }
+
+    Property* PropertyStorage::getPropertyAt(const std::string& prop_name, Version version, VersionStatus* status) const
+    {
+        VersionStatus result = VersionStatus::Status_NotReached;
+        Property* p = nullptr;
+
+        if (version != 0 && version <= currentVersion())
+        {
+            result = VersionStatus::Status_NotDefined;
+            size_t slot = pinReader(version);
+            if (const VersionChain* chain = findChain(m_versions.load(), prop_name))
+            {
+                const Property* value;
+                result = findVersion(chain->head, version, value);
+                p = cloneProperty(value);
+            }
+            unpinReader(slot);
+
+            if (result == VersionStatus::Status_NotDefined && version < m_droppedVersion.load())
+                result = VersionStatus::Status_NotRetained;
+        }
+
+        if (status)
+            *status = result;
+        return p;
+    }
+
+    bool PropertyStorage::readAt(Version version, const std::vector<std::string>& prop_names, std::vector<Property*>& values) const
+    {
+        // Consistent multi-key read: not defined (and not retained) properties are returned as nullptr
+        values.assign(prop_names.size(), nullptr);
+        if (version == 0 || version > currentVersion())
+            return false;
+
+        bool retained = true;
+        size_t slot = pinReader(version);
+        const VersionTable* table = m_versions.load();
+        for (size_t i = 0; i < prop_names.size(); ++i)
+        {
+            if (const VersionChain* chain = findChain(table, prop_names[i]))
+            {
+                const Property* value;
+                if (findVersion(chain->head, version, value) == VersionStatus::Status_NotRetained)
+                    retained = false;
+                values[i] = cloneProperty(value);
+            }
+            if (!values[i] && version < m_droppedVersion.load())
+                retained = false;
+        }
+        unpinReader(slot);
+
+        return retained;
+    }
+
+    bool PropertyStorage::snapshotAt(Version version, PropertyStorage& snapshot) const
+    {
+        // Fills "snapshot" storage with all properties visible at the version
+        if (version == 0 || version > currentVersion())
+            return false;
+
+        bool retained = true;
+        size_t slot = pinReader(version);
+        if (const VersionTable* table = m_versions.load())
+        {
+            for (const auto& it : table->slots)
+            {
+                const VersionChain* chain = it.load();
+                if (!chain)
+                    continue;
+
+                const Property* value;
+                VersionStatus status = findVersion(chain->head, version, value);
+                if (status == VersionStatus::Status_Found)
+                    snapshot.defineProperty(chain->name, value);
+                else if (status == VersionStatus::Status_NotRetained)
+                    retained = false;
+            }
+        }
+        unpinReader(slot);
+
+        if (version < m_droppedVersion.load())
+            retained = false;
+
+        return retained;
+    }
 }
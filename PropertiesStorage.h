@@ -3,12 +3,19 @@
 #include <sstream>
 #include <iostream>
 #include <map>
+#include <vector>
+#include <span>
+#include <string_view>
 #include <typeinfo>
+#include <functional>
+#include <atomic>
+#include <mutex>
 
 namespace Storage
 {
     typedef signed __int64 Int64;
     typedef signed __int32 Int32;
+    typedef unsigned __int64 UInt64;
     typedef std::string    String;
     typedef double         Double;
 
@@ -50,6 +57,8 @@ namespace Storage
     {
     public:
 
+        virtual ~Property() { }
+
         virtual PropertyType getType() const = 0;
         virtual std::string getAsString() const = 0;
         virtual bool fromString(const std::string& value) = 0;
@@ -117,6 +126,92 @@ namespace Storage
     // --------------------------------------------------------------------------------------------
 
     using PropertyMap = std::map<std::string, Property*>;
+    using ChangeListener = std::function<void(const std::string& prop_name)>;
+
+    // Open addressing hash index over PropertyMap (keys point into the map nodes) for batch lookups.
+    // Slots keep full hashes, so probing touches a key only when its hash matches.
+    class PropertyIndex
+    {
+    public:
+
+        static UInt64 hashOf(std::string_view key);
+
+        void insert(const std::string& key, Property* value);
+        void erase(const std::string& key);
+        void rebuild(const PropertyMap& props);
+        void clear() { m_slots.clear(); m_count = 0; }
+
+        const Property* find(std::string_view key) const;
+        void findMany(const std::string_view* keys, const Property** values, size_t count) const;
+
+    private:
+
+        struct Slot
+        {
+            UInt64 hash = 0;
+            const std::string* key = nullptr;       // nullptr - free slot
+            Property* value = nullptr;
+        };
+
+        static constexpr size_t BatchSize = 16;
+
+        size_t slotOf(UInt64 hash) const { return static_cast<size_t>(hash) & (m_slots.size() - 1); }
+        void grow();
+
+        std::vector<Slot> m_slots;
+        size_t m_count = 0;
+    };
+
+    // Versioning (MVCC) -------------------------------------------------------------------------
+
+    using Version = UInt64;
+
+    enum class VersionStatus
+    {
+        Status_Found,
+        Status_NotDefined,      // property was not defined (or was deleted) at the version
+        Status_NotRetained,     // version of the property was dropped by garbage collection
+        Status_NotReached,      // version is 0 or newer than the current one
+    };
+
+    // One node of a property version chain (chains are ordered from the newest to the oldest node).
+    // Value is immutable once the node is published, nullptr value means that property was deleted.
+    // "trimmed" is set on the oldest retained node when older nodes are dropped.
+    struct PropVersion
+    {
+        PropVersion(Version ver, Property* val, PropVersion* older) : version(ver), value(val), next(older) { }
+        ~PropVersion() { delete value; }
+
+        Version version;
+        Property* value;
+        std::atomic<PropVersion*> next;
+        std::atomic<bool> trimmed{ false };
+    };
+
+    // Version chain of one property
+    struct VersionChain
+    {
+        VersionChain(const std::string& prop_name, UInt64 prop_hash) : name(prop_name), hash(prop_hash) { }
+        ~VersionChain();
+
+        std::string name;
+        UInt64 hash;
+        std::atomic<PropVersion*> head{ nullptr };
+        bool dropped = false;       // history is dropped by collectGarbage (the chain is left out of the next table)
+    };
+
+    // Open addressing table of version chains (linear probing, load factor <= 1/2).
+    // The writer adds chains in place and readers probe the table without locks. A grown table
+    // replaces the old one, which is retired like unlinked nodes (chains are shared by both tables).
+    struct VersionTable
+    {
+        explicit VersionTable(size_t size) : slots(size) { }
+
+        std::vector<std::atomic<VersionChain*>> slots;
+        size_t count = 0;
+    };
+
+    // --------------------------------------------------------------------------------------------
 
     class PropertyStorage
     {
@@ -133,27 +228,55 @@ namespace Storage
                 it.second = nullptr;
             }
             m_propStorage.clear(); 
+            clearVersions();
         }
         void operator= (const PropertyStorage& rVal);
 
         bool defineProperty(const std::string &prop_name, PropertyType prop_type);
+        bool defineProperty(const std::string& prop_name, const Property* value);     // defines the property with a copy of the value
         bool isProperyDefined(const std::string& prop_name) { return m_propStorage.find(prop_name) != m_propStorage.end(); }
 
         const Property* getProperty(const std::string &prop_name) const;
+        const Property* findProperty(std::string_view prop_name) const { return m_propIndex.find(prop_name); }    // last error is not updated
+        std::vector<const Property*> getMany(std::span<const std::string_view> prop_names) const;    // nullptr for not defined, last error is not updated
         bool setProperty(const std::string &prop_name, const Property* p);
         bool deleteProperty(const std::string& prop_name);
 
         size_t propCount() const { return m_propStorage.size(); }
-        bool saveStorage() const;
-        bool loadStorage();
+        bool saveStorage(const std::string& file_name, bool compress = true) const;
+        bool loadStorage(const std::string& file_name);
+        bool saveStorage(std::ostream& out, bool compress = true) const;
+        bool loadStorage(std::istream& in);       // changes only differing properties, one version per change (not atomic)
+        bool replaceContent(PropertyStorage& source);     // the same for a loaded storage (its properties can be moved out)
 
         void setName(const std::string& name) { m_storageName = name; }
         std::string getName() const { return m_storageName; }
         
         std::string getLastError() const { return m_lastError; }
 
+        // Listener is called after every definition, change or deletion of a property (in the writer's thread)
+        void setChangeListener(ChangeListener listener) { m_changeListener = listener; }
+
         static Property* createProperty(PropertyType prop_type);
         static Property* createProperty(const std::string &value);
+        static Property* cloneProperty(const Property* p);
+
+        // Versioning (MVCC)
+        // Every change of a property creates a new version of it, all versions are numbered by one global counter.
+        // Readers below can run concurrently with a writer, neither of them takes a lock the other one waits for
+        // (writers have to be serialized by the caller).
+        // They return new objects (caller deletes them) and do not update last error.
+
+        bool enableVersioning(size_t retention_depth);    // 0 disables versioning and drops all history
+        bool isVersioningEnabled() const { return m_retentionDepth > 0; }
+        size_t getRetentionDepth() const { return m_retentionDepth; }
+        Version currentVersion() const { return m_version.load(); }
+
+        // readAt/snapshotAt return false if the version is not reached or some of the values are not retained anymore
+        Property* getPropertyAt(const std::string& prop_name, Version version, VersionStatus* status = nullptr) const;
+        bool readAt(Version version, const std::vector<std::string>& prop_names, std::vector<Property*>& values) const;
+        bool snapshotAt(Version version, PropertyStorage& snapshot) const;
+        void collectGarbage();      // trims all chains and drops history of deleted properties that no reader can see
 
         // Helper methods for convinience (if you sure about the type of the property and you know that propery is defined)
 
@@ -173,9 +296,38 @@ namespace Storage
         bool setProp(const std::string& prop_name, const Double& val);
 
     private:
+        static const size_t MaxReaders = 64;
+
+        bool addProperty(const std::string& prop_name, Property* p);
+        void propertyChanged(const std::string& prop_name, const Property* p);
+        void publishVersion(const std::string& prop_name, const Property* p);
+        void trimChain(std::atomic<PropVersion*>& head);
+        void reclaimRetired();
+        void clearVersions();
+        size_t pinReader(Version version) const;
+        void unpinReader(size_t slot) const { m_readerPins[slot].store(0); }
+        Version oldestPinnedVersion() const;
+        static VersionStatus findVersion(const std::atomic<PropVersion*>& head, Version version, const Property*& value);
+        static const VersionChain* findChain(const VersionTable* table, const std::string& prop_name);
+        static void insertChain(VersionTable& table, VersionChain* chain);
+        VersionChain* chainOf(const std::string& prop_name);
+        void rebuildVersions();
+
         std::string m_storageName;
         PropertyMap m_propStorage;
+        PropertyIndex m_propIndex;
         mutable std::string m_lastError;
+        ChangeListener m_changeListener;
+
+        size_t m_retentionDepth = 0;
+        std::atomic<Version> m_version{ 0 };
+        std::atomic<VersionTable*> m_versions{ nullptr };
+        std::mutex m_writeLock;                                          // serializes publishing and reclamation
+        std::vector<std::pair<Version, PropVersion*>> m_retired;         // unlinked nodes waiting for readers to leave
+        std::vector<std::pair<Version, VersionTable*>> m_retiredTables;  // replaced tables waiting for readers to leave
+        std::vector<std::pair<Version, VersionChain*>> m_retiredChains;  // dropped chains waiting for readers to leave
+        std::atomic<Version> m_droppedVersion{ 0 };                      // versions older than it may miss dropped chains
+        mutable std::atomic<Version> m_readerPins[MaxReaders] = {};      // versions pinned by active readers (0 - free slot)
     };
     
     inline std::ostream& operator<<(std::ostream& out, const PropertyStorage &p)
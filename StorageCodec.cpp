@@ -0,0 +1,353 @@
+#include <cstring>
+#include <algorithm>
+#include "StorageCodec.h"
+
+namespace Storage
+{
+    // Block codec -------------------------------------------------------------------------------------
+    //
+    // Block is a sequence of { token, [literal length], literals, offset (2 bytes), [match length] }.
+    // Token keeps literal length in high 4 bits and (match length - 4) in low 4 bits, 15 means that
+    // the rest of the length follows as varint. The last sequence of the block has literals only.
+
+    namespace
+    {
+        const size_t MinMatch = 4;
+        const size_t MaxOffset = 0xFFFF;
+        const unsigned int HashBits = 12;
+
+        inline unsigned int hash4(const unsigned char* p)
+        {
+            unsigned int v;
+            memcpy(&v, p, sizeof(v));
+            return (v * 2654435761u) >> (32 - HashBits);
+        }
+
+        inline void putVarint(std::vector<char>& dst, UInt64 v)
+        {
+            while (v >= 0x80)
+            {
+                dst.push_back(static_cast<char>(v | 0x80));
+                v >>= 7;
+            }
+            dst.push_back(static_cast<char>(v));
+        }
+
+        inline bool getVarint(const unsigned char*& p, const unsigned char* end, UInt64& v)
+        {
+            v = 0;
+            for (unsigned int shift = 0; shift < 64 && p < end; shift += 7)
+            {
+                unsigned char c = *p++;
+                v |= static_cast<UInt64>(c & 0x7F) << shift;
+                if (!(c & 0x80))
+                    return true;
+            }
+            return false;
+        }
+
+        void putSequence(std::vector<char>& dst, const unsigned char* literals, size_t literal_len, size_t offset, size_t match_len)
+        {
+            size_t lit = std::min<size_t>(literal_len, 15);
+            size_t match = match_len ? std::min<size_t>(match_len - MinMatch, 15) : 0;
+
+            dst.push_back(static_cast<char>((lit << 4) | match));
+            if (lit == 15)
+                putVarint(dst, literal_len - 15);
+            dst.insert(dst.end(), literals, literals + literal_len);
+
+            if (match_len)
+            {
+                dst.push_back(static_cast<char>(offset & 0xFF));
+                dst.push_back(static_cast<char>(offset >> 8));
+                if (match == 15)
+                    putVarint(dst, match_len - MinMatch - 15);
+            }
+        }
+    }
+
+    size_t packBlock(const char* src, size_t size, std::vector<char>& dst)
+    {
+        dst.clear();
+
+        const unsigned char* in = reinterpret_cast<const unsigned char*>(src);
+        int table[1 << HashBits];
+        std::fill(std::begin(table), std::end(table), -1);
+
+        size_t anchor = 0, pos = 0;
+        while (pos + MinMatch <= size)
+        {
+            unsigned int h = hash4(in + pos);
+            int candidate = table[h];
+            table[h] = static_cast<int>(pos);
+
+            if (candidate >= 0 && pos - candidate <= MaxOffset && memcmp(in + candidate, in + pos, MinMatch) == 0)
+            {
+                size_t len = MinMatch;
+                while (pos + len < size && in[candidate + len] == in[pos + len])
+                    ++len;
+
+                putSequence(dst, in + anchor, pos - anchor, pos - candidate, len);
+                pos += len;
+                anchor = pos;
+            }
+            else
+                ++pos;
+        }
+
+        if (anchor < size)
+            putSequence(dst, in + anchor, size - anchor, 0, 0);
+
+        return dst.size();
+    }
+
+    bool unpackBlock(const char* src, size_t size, char* dst, size_t raw_size)
+    {
+        const unsigned char* p = reinterpret_cast<const unsigned char*>(src);
+        const unsigned char* end = p + size;
+        size_t out = 0;
+
+        while (out < raw_size)
+        {
+            if (p >= end)
+                return false;
+
+            unsigned char token = *p++;
+            UInt64 literal_len = token >> 4;
+            if (literal_len == 15)
+            {
+                UInt64 ext;
+                if (!getVarint(p, end, ext) || ext > raw_size)
+                    return false;
+                literal_len += ext;
+            }
+
+            if (literal_len > static_cast<UInt64>(end - p) || literal_len > raw_size - out)
+                return false;
+            memcpy(dst + out, p, static_cast<size_t>(literal_len));
+            p += literal_len;
+            out += static_cast<size_t>(literal_len);
+
+            if (out == raw_size)
+                break;
+
+            if (end - p < 2)
+                return false;
+            size_t offset = p[0] | (p[1] << 8);
+            p += 2;
+
+            UInt64 match_len = (token & 0x0F) + MinMatch;
+            if ((token & 0x0F) == 15)
+            {
+                UInt64 ext;
+                if (!getVarint(p, end, ext) || ext > raw_size)
+                    return false;
+                match_len += ext;
+            }
+
+            if (offset == 0 || offset > out || match_len > raw_size - out)
+                return false;
+
+            // Byte by byte since a match may overlap with its own output
+            for (size_t i = 0; i < match_len; ++i, ++out)
+                dst[out] = dst[out - offset];
+        }
+
+        return p == end;
+    }
+
+    // CodecWriter functions ---------------------------------------------------------------------------
+
+    static void writeVarint(std::ostream& out, UInt64 v)
+    {
+        while (v >= 0x80)
+        {
+            out.put(static_cast<char>(v | 0x80));
+            v >>= 7;
+        }
+        out.put(static_cast<char>(v));
+    }
+
+    void CodecWriter::putByte(unsigned char c)
+    {
+        m_block.push_back(static_cast<char>(c));
+        if (m_block.size() == CodecBlockSize)
+            flushBlock();
+    }
+
+    void CodecWriter::write(const char* data, size_t size)
+    {
+        while (size > 0)
+        {
+            size_t chunk = std::min(size, CodecBlockSize - m_block.size());
+            m_block.insert(m_block.end(), data, data + chunk);
+            data += chunk;
+            size -= chunk;
+
+            if (m_block.size() == CodecBlockSize)
+                flushBlock();
+        }
+    }
+
+    void CodecWriter::putVarint(UInt64 v)
+    {
+        while (v >= 0x80)
+        {
+            putByte(static_cast<unsigned char>(v | 0x80));
+            v >>= 7;
+        }
+        putByte(static_cast<unsigned char>(v));
+    }
+
+    void CodecWriter::flushBlock()
+    {
+        if (m_block.empty())
+            return;
+
+        if (!m_compress)
+            m_out.write(m_block.data(), m_block.size());
+        else
+        {
+            writeVarint(m_out, m_block.size());
+            if (packBlock(m_block.data(), m_block.size(), m_packed) < m_block.size())
+            {
+                writeVarint(m_out, m_packed.size());
+                m_out.write(m_packed.data(), m_packed.size());
+            }
+            else
+            {
+                writeVarint(m_out, 0);
+                m_out.write(m_block.data(), m_block.size());
+            }
+        }
+        m_block.clear();
+    }
+
+    bool CodecWriter::finish()
+    {
+        flushBlock();
+        if (m_compress)
+            writeVarint(m_out, 0);
+
+        m_out.flush();
+        return !m_out.fail();
+    }
+
+    // CodecReader functions ---------------------------------------------------------------------------
+
+    bool CodecReader::getRawVarint(UInt64& v)
+    {
+        v = 0;
+        for (unsigned int shift = 0; shift < 64; shift += 7)
+        {
+            int c = m_in.get();
+            if (c == std::char_traits<char>::eof())
+                return false;
+
+            v |= static_cast<UInt64>(c & 0x7F) << shift;
+            if (!(c & 0x80))
+                return true;
+        }
+        return false;
+    }
+
+    bool CodecReader::loadBlock()
+    {
+        m_pos = 0;
+        m_block.clear();
+        if (m_finished || m_corrupted)
+            return false;
+
+        if (!m_compressed)
+        {
+            m_block.resize(CodecBlockSize);
+            m_in.read(m_block.data(), m_block.size());
+            m_block.resize(static_cast<size_t>(m_in.gcount()));
+            m_finished = m_block.empty();
+            return !m_finished;
+        }
+
+        UInt64 raw_size, packed_size;
+        if (!getRawVarint(raw_size))
+        {
+            m_corrupted = true;
+            return false;
+        }
+        if (raw_size == 0)
+        {
+            m_finished = true;
+            return false;
+        }
+
+        if (raw_size > CodecBlockSize || !getRawVarint(packed_size) || packed_size >= raw_size)
+        {
+            m_corrupted = true;
+            return false;
+        }
+
+        m_block.resize(static_cast<size_t>(raw_size));
+        if (packed_size == 0)
+            m_corrupted = !m_in.read(m_block.data(), m_block.size());
+        else
+        {
+            m_packed.resize(static_cast<size_t>(packed_size));
+            m_corrupted = !m_in.read(m_packed.data(), m_packed.size()) ||
+                          !unpackBlock(m_packed.data(), m_packed.size(), m_block.data(), m_block.size());
+        }
+
+        if (m_corrupted)
+            m_block.clear();
+        return !m_corrupted;
+    }
+
+    bool CodecReader::getByte(unsigned char& c)
+    {
+        if (m_pos == m_block.size() && !loadBlock())
+            return false;
+
+        c = static_cast<unsigned char>(m_block[m_pos++]);
+        return true;
+    }
+
+    bool CodecReader::read(std::string& s, size_t size)
+    {
+        // Appends data by chunks, so a wrong size cannot cause a huge allocation
+        s.clear();
+        while (size > 0)
+        {
+            if (m_pos == m_block.size() && !loadBlock())
+                return false;
+
+            size_t chunk = std::min(size, m_block.size() - m_pos);
+            s.append(m_block.data() + m_pos, chunk);
+            m_pos += chunk;
+            size -= chunk;
+        }
+        return true;
+    }
+
+    bool CodecReader::atEnd()
+    {
+        if (m_pos != m_block.size() || loadBlock() || m_corrupted)
+            return false;
+
+        return m_in.peek() == std::char_traits<char>::eof();
+    }
+
+    bool CodecReader::getVarint(UInt64& v)
+    {
+        v = 0;
+        unsigned char c;
+        for (unsigned int shift = 0; shift < 64; shift += 7)
+        {
+            if (!getByte(c))
+                return false;
+
+            v |= static_cast<UInt64>(c & 0x7F) << shift;
+            if (!(c & 0x80))
+                return true;
+        }
+        m_corrupted = true;
+        return false;
+    }
+}
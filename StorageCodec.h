@@ -0,0 +1,74 @@
+#pragma once
+
+#include <iostream>
+#include <string>
+#include <vector>
+#include "PropertiesStorage.h"
+
+namespace Storage
+{
+    // Streaming layer of the storage file format.
+    // Data is written either as is or packed into independent blocks (LZ77 with 64K window),
+    // so both directions need only one block of memory regardless of the storage size.
+    //
+    // Compressed stream: { varint raw_size, varint packed_size (0 - block is stored), bytes }..., varint 0
+
+    const size_t CodecBlockSize = 64 * 1024;
+
+    inline UInt64 zigzagEncode(Int64 v) { return (static_cast<UInt64>(v) << 1) ^ static_cast<UInt64>(v >> 63); }
+    inline Int64 zigzagDecode(UInt64 v) { return static_cast<Int64>(v >> 1) ^ -static_cast<Int64>(v & 1); }
+
+    size_t packBlock(const char* src, size_t size, std::vector<char>& dst);
+    bool unpackBlock(const char* src, size_t size, char* dst, size_t raw_size);
+
+    // --------------------------------------------------------------------------------------------
+
+    class CodecWriter
+    {
+    public:
+
+        CodecWriter(std::ostream& out, bool compress) : m_out(out), m_compress(compress) { }
+
+        void putByte(unsigned char c);
+        void write(const char* data, size_t size);
+        void putVarint(UInt64 v);
+        bool finish();
+
+    private:
+
+        void flushBlock();
+
+        std::ostream& m_out;
+        bool m_compress;
+        std::vector<char> m_block;
+        std::vector<char> m_packed;
+    };
+
+    // --------------------------------------------------------------------------------------------
+
+    class CodecReader
+    {
+    public:
+
+        CodecReader(std::istream& in, bool compressed) : m_in(in), m_compressed(compressed) { }
+
+        bool getByte(unsigned char& c);
+        bool read(std::string& s, size_t size);
+        bool getVarint(UInt64& v);
+        bool isCorrupted() const { return m_corrupted; }
+        bool atEnd();       // true if no data follows (compressed stream: only the end marker)
+
+    private:
+
+        bool loadBlock();
+        bool getRawVarint(UInt64& v);
+
+        std::istream& m_in;
+        bool m_compressed;
+        bool m_corrupted = false;
+        bool m_finished = false;
+        std::vector<char> m_block;
+        std::vector<char> m_packed;
+        size_t m_pos = 0;
+    };
+}